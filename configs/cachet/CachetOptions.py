@@ -0,0 +1,66 @@
+def addCachetOptions(parser):
+    """Options of the Cachet memory channels, shared by the configs"""
+    parser.add_argument("--meta-prefetch-degree", type=int, default=0,
+                        help="MAC lines prefetched ahead of a data stream "
+                        "into the meta cache, 0 disables the prefetcher")
+    parser.add_argument("--mac-in-ecc", action="store_true",
+                        help="Fetch the MACs with their data instead of "
+                        "from a separate MAC region")
+    parser.add_argument("--mac-burst-bytes", type=int, default=0,
+                        help="Extra bytes a burst carries for its MAC with "
+                        "--mac-in-ecc, 0 if they fit in the ECC chips")
+    parser.add_argument("--meta-row-placement", action="store_true",
+                        help="Keep the MACs in the DRAM rows of their data "
+                        "instead of rows of their own")
+    parser.add_argument("--cachet-scheme", default="cachetree",
+                        choices=["none", "ct", "mt", "cachetree"],
+                        help="Integrity scheme of the memory channels")
+    parser.add_argument("--counter-arity", type=int, default=None,
+                        help="Data blocks covered by a counter block")
+    parser.add_argument("--tree-arity", type=int, default=None,
+                        help="Arity of the integrity tree")
+    parser.add_argument("--split-counters", action="store_true",
+                        help="Use split major/minor counters")
+    parser.add_argument("--meta-cache-size", default=None,
+                        help="Size of the metadata cache of every channel")
+    parser.add_argument("--meta-mac-ways", type=int, default=0,
+                        help="Cap of the meta cache ways holding MACs")
+    parser.add_argument("--meta-counter-ways", type=int, default=0,
+                        help="Cap of the meta cache ways holding counters")
+    parser.add_argument("--meta-tree-ways", type=int, default=0,
+                        help="Cap of the meta cache ways holding tree nodes")
+    parser.add_argument("--meta-no-priority", action="store_true",
+                        help="Let the meta cache evict upper tree levels "
+                        "like any other block")
+    parser.add_argument("--meta-compression", type=int, default=1,
+                        help="Counter blocks that may share a meta cache "
+                        "data entry when they compress, needs "
+                        "--split-counters and drops the way caps")
+    parser.add_argument("--write-buffer-entries", type=int, default=0,
+                        help="Posted write buffer of the secure controller, "
+                        "drained at 3/4 full down to 1/4")
+    parser.add_argument("--aes-latency", type=int, default=None,
+                        help="Cycles to generate a counter-mode pad, "
+                        "decryption is not modelled if not given")
+    parser.add_argument("--aes-lanes", type=int, default=1,
+                        help="Independent pipelines of the AES engine")
+    parser.add_argument("--aes-interval", type=int, default=1,
+                        help="Cycles between two pads on one AES pipeline")
+    parser.add_argument("--persist-mode", default="none",
+                        choices=["none", "strict", "shadow"],
+                        help="Crash consistency of the tree with an NVM "
+                        "backing, for the mt and cachetree schemes")
+    parser.add_argument("--protected-ranges", default=None,
+                        help="Comma separated start:size physical regions "
+                        "to protect, e.g. 0x40000000:512MiB, the rest "
+                        "bypasses Cachet. All the memory if not given")
+    parser.add_argument("--verify-data", action="store_true",
+                        help="Compute real MACs and tree hashes over the "
+                        "data and check them on every read")
+    parser.add_argument("--fault-addr", type=lambda x: int(x, 0),
+                        default=None,
+                        help="Corrupt this data, counter or tree node "
+                        "address to check the tampering is caught, needs "
+                        "--verify-data")
+    parser.add_argument("--fault-tick", type=int, default=0,
+                        help="Tick at which --fault-addr is corrupted")
@@ -1,4 +1,4 @@
-from m5.objects import Cache
+from m5.objects import Cache, MetaTags
 from m5.params import *
 
 class MetaCache(Cache):
@@ -10,3 +10,5 @@ class MetaCache(Cache):
     mshrs = 4
     tgts_per_mshr = 20
     writeback_clean = False
+    # Keeps the upper tree levels and can partition the ways by kind
+    tags = MetaTags()
@@ -1,86 +1,219 @@
 import m5.objects
 from m5.objects import *
+from m5.util import fatal
 from MetaCache import MetaCache
 
-def CTConfig(i, system, xbar, mem_ctrls):
+def CachetChannel(channel_range, options = None):
+    # One Cachet pipeline per memory channel. The channel keeps its own
+    # tree, laid out in the interleaved range of the channel so that the
+    # metadata never crosses to another channel, and its own root.
+    channel = SubSystem()
+    channel.integrity_layout = IntegrityLayout(channel_range = channel_range)
+    # The MAC travels with the data burst instead of its own region
+    channel.integrity_layout.mac_in_ecc = getattr(options, "mac_in_ecc",
+                                                  False)
+    # Geometry knobs swept by the design space exploration
+    if getattr(options, "counter_arity", None):
+        channel.integrity_layout.counter_arity = options.counter_arity
+    if getattr(options, "tree_arity", None):
+        channel.integrity_layout.tree_arity = options.tree_arity
+    if getattr(options, "split_counters", False):
+        channel.integrity_layout.split_counters = True
+    channel.hash_engine = HashEngine()
+    channel.sec_ctrl = SecCtrl()
+    write_buffer = getattr(options, "write_buffer_entries", 0)
+    if write_buffer > 0:
+        channel.sec_ctrl.write_buffer_entries = write_buffer
+        channel.sec_ctrl.write_high_watermark = max(1, write_buffer * 3 // 4)
+        channel.sec_ctrl.write_low_watermark = write_buffer // 4
+    # Only these regions pay for the integrity protection
+    if getattr(options, "protected_ranges", None):
+        channel.sec_ctrl.protected_ranges = [
+                AddrRange(int(start, 0), size = size) for start, size in
+                (r.split(":") for r in options.protected_ranges.split(","))]
+    if getattr(options, "verify_data", False):
+        channel.sec_ctrl.verify_data = True
+        # Every channel gets the fault, the one owning the address acts
+        # on it
+        if getattr(options, "fault_addr", None) is not None:
+            channel.sec_ctrl.fault_addr = options.fault_addr
+            channel.sec_ctrl.fault_tick = options.fault_tick
+    # Counter-mode decryption, the pads come from their own pipelined
+    # engine so that the hash engine of the channel stays its only one
+    if getattr(options, "aes_latency", None):
+        channel.sec_ctrl.aes_engine = HashEngine(
+                lanes = options.aes_lanes,
+                pipeline_depth = options.aes_latency,
+                initiation_interval = options.aes_interval)
+    channel.read_ctrl = CTRead()
+    channel.meta_cache = MetaCache()
+    if getattr(options, "meta_cache_size", None):
+        channel.meta_cache.size = options.meta_cache_size
+    meta_compression = getattr(options, "meta_compression", 1)
+    if meta_compression > 1:
+        # Neighbouring counter blocks share a data entry when their minor
+        # counters compress well enough
+        channel.meta_cache.tags = MetaCompressedTags(
+                max_compression_ratio = meta_compression)
+        channel.meta_cache.compressor = CounterCompressor()
+    else:
+        tags = channel.meta_cache.tags
+        tags.mac_ways = getattr(options, "meta_mac_ways", 0)
+        tags.counter_ways = getattr(options, "meta_counter_ways", 0)
+        tags.tree_ways = getattr(options, "meta_tree_ways", 0)
+        tags.keep_upper_levels = not getattr(options, "meta_no_priority",
+                                             False)
+    channel.meta_bus = SystemXBar()
+    channel.mem_bus = SystemXBar()
+
+    # The prefetcher follows the data stream seen by the secure controller
+    # and fills the meta cache ahead of the verification walks
+    prefetch_degree = getattr(options, "meta_prefetch_degree", 0)
+    if prefetch_degree > 0:
+        channel.meta_prefetcher = MetaPrefetcher(degree = prefetch_degree)
+        channel.sec_ctrl.prefetcher = channel.meta_prefetcher
+        channel.meta_bus.cpu_side_ports = \
+                channel.meta_prefetcher.mem_side_port
+    return channel
+
+def PersistConfig(channel, options = None):
+    # With an NVM backing, the tree updates of the MT write controllers
+    # can be ordered with their persists. The shadow table mirrors the
+    # meta cache, one entry per block.
+    mode = getattr(options, "persist_mode", "none")
+    channel.write_ctrl.persist_mode = mode
+    if mode == "shadow":
+        channel.integrity_layout.shadow_entries = \
+                channel.meta_cache.size.value // \
+                int(channel.integrity_layout.block_size)
+
+def RowPlacementConfig(channel, mem_ctrl, options = None):
+    # The DRAM counts the bursts above the protected data as metadata in
+    # its row buffer stats. With the row placement, every DRAM row keeps
+    # its tail for the MACs of its data, so that a MAC fetch finds the
+    # row its data access opened. Every scheme calls this in both the
+    # classic and the Ruby memory systems.
+    dram = getattr(mem_ctrl, "dram", None)
+    if not isinstance(dram, DRAMInterface):
+        return
+    layout = channel.integrity_layout
+    dram.metadata_start = layout.protected_size.value
+    # The MACs co-located with the data either use the ECC chips or
+    # lengthen every burst
+    if layout.mac_in_ecc:
+        dram.extra_burst_bytes = getattr(options, "mac_burst_bytes", 0)
+    if not getattr(options, "meta_row_placement", False):
+        return
+    if layout.mac_in_ecc:
+        fatal("--meta-row-placement places the MAC region, it has no use "
+              "with --mac-in-ecc")
+
+    block = int(layout.block_size)
+    mac = int(layout.mac_size)
+    row = dram.device_rowbuffer_size.value * int(dram.devices_per_rank)
+    # As much data as fits with its MACs, in whole MAC blocks
+    macs_per_block = block * block // mac
+    data = row * block // (block + mac) // macs_per_block * macs_per_block
+    layout.row_data_bytes = data
+    dram.row_data_bytes = data
+    dram.row_meta_bytes = data * mac // block
+
+# Every scheme takes the port the channel hangs off, a membus port in a
+# classic system or the memory port of a Ruby directory, see
+# ruby/Ruby.py
+def NoCachetConfig(i, system, upstream, mem_ctrls, channel_range,
+        options = None):
+    # Unprotected baseline, the memory hangs off the upstream port
+    mem_ctrls[i].port = upstream
+
+def CTConfig(i, system, upstream, mem_ctrls, channel_range,
+        options = None):
     # Insert the security controllers between
-    # the memory controllers and the membus
-    system.sec_ctrl = SecCtrl()
-    system.read_ctrl = CTRead()
-    system.write_ctrl = CTWrite()
-    system.meta_cache = MetaCache()
-    system.meta_bus = SystemXBar()
-    system.mem_bus = SystemXBar()
+    # the memory controllers and the upstream port
+    channel = CachetChannel(channel_range, options)
+    setattr(system, "cachet%d" % i, channel)
+    channel.write_ctrl = CTWrite()
+    RowPlacementConfig(channel, mem_ctrls[i], options)
 
-    xbar.mem_side_ports = system.sec_ctrl.cpu_side_port
-    system.sec_ctrl.read_port = \
-            system.read_ctrl.cpu_side_port
-    system.sec_ctrl.write_port = \
-            system.write_ctrl.cpu_side_port
-    system.meta_bus.cpu_side_ports = [
-            system.read_ctrl.mem_side_port
+    channel.sec_ctrl.cpu_side_port = upstream
+    channel.sec_ctrl.read_port = \
+            channel.read_ctrl.cpu_side_port
+    channel.sec_ctrl.write_port = \
+            channel.write_ctrl.cpu_side_port
+    channel.sec_ctrl.write_ctrl = channel.write_ctrl
+    channel.meta_bus.cpu_side_ports = [
+            channel.read_ctrl.mem_side_port
             ]
-    system.meta_bus.mem_side_ports = \
-            system.meta_cache.cpu_side
-    system.mem_bus.cpu_side_ports = [
-            system.write_ctrl.mem_side_port,
-            system.meta_cache.mem_side,
-            system.sec_ctrl.mem_side_port
+    channel.meta_bus.mem_side_ports = \
+            channel.meta_cache.cpu_side
+    channel.mem_bus.cpu_side_ports = [
+            channel.write_ctrl.mem_side_port,
+            channel.meta_cache.mem_side,
+            channel.sec_ctrl.mem_side_port
             ]
-    mem_ctrls[i].port = system.mem_bus.mem_side_ports
+    mem_ctrls[i].port = channel.mem_bus.mem_side_ports
 
-def MTConfig(i, system, xbar, mem_ctrls):
+def MTConfig(i, system, upstream, mem_ctrls, channel_range,
+        options = None):
     # Insert the security controllers between
-    # the memory controllers and the membus
-    system.sec_ctrl = SecCtrl()
-    system.read_ctrl = CTRead()
-    system.write_ctrl = MTWrite()
-    system.meta_cache = MetaCache()
-    system.meta_bus = SystemXBar()
-    system.mem_bus = SystemXBar()
+    # the memory controllers and the upstream port
+    channel = CachetChannel(channel_range, options)
+    setattr(system, "cachet%d" % i, channel)
+    channel.write_ctrl = MTWrite()
+    PersistConfig(channel, options)
+    RowPlacementConfig(channel, mem_ctrls[i], options)
 
-    xbar.mem_side_ports = system.sec_ctrl.cpu_side_port
-    system.sec_ctrl.read_port = \
-            system.read_ctrl.cpu_side_port
-    system.sec_ctrl.write_port = \
-            system.write_ctrl.cpu_side_port
-    system.meta_bus.cpu_side_ports = [
-            system.write_ctrl.mem_side_port,
-            system.read_ctrl.mem_side_port
+    channel.sec_ctrl.cpu_side_port = upstream
+    channel.sec_ctrl.read_port = \
+            channel.read_ctrl.cpu_side_port
+    channel.sec_ctrl.write_port = \
+            channel.write_ctrl.cpu_side_port
+    channel.sec_ctrl.write_ctrl = channel.write_ctrl
+    channel.meta_bus.cpu_side_ports = [
+            channel.write_ctrl.mem_side_port,
+            channel.read_ctrl.mem_side_port
             ]
-    system.meta_bus.mem_side_ports = \
-            system.meta_cache.cpu_side
-    system.mem_bus.cpu_side_ports = [
-            system.write_ctrl.mem_bypass_port,
-            system.meta_cache.mem_side,
-            system.sec_ctrl.mem_side_port
+    channel.meta_bus.mem_side_ports = \
+            channel.meta_cache.cpu_side
+    channel.mem_bus.cpu_side_ports = [
+            channel.write_ctrl.mem_bypass_port,
+            channel.meta_cache.mem_side,
+            channel.sec_ctrl.mem_side_port
             ]
-    mem_ctrls[i].port = system.mem_bus.mem_side_ports
+    mem_ctrls[i].port = channel.mem_bus.mem_side_ports
 
-def CacheTreeConfig(i, system, xbar, mem_ctrls):
+def CacheTreeConfig(i, system, upstream, mem_ctrls, channel_range,
+        options = None):
     # Insert the security controllers between
-    # the memory controllers and the membus
-    system.sec_ctrl = SecCtrl()
-    system.read_ctrl = CTRead()
-    system.write_ctrl = CacheTree()
-    system.meta_cache = MetaCache()
-    system.meta_bus = SystemXBar()
-    system.mem_bus = SystemXBar()
+    # the memory controllers and the upstream port
+    channel = CachetChannel(channel_range, options)
+    setattr(system, "cachet%d" % i, channel)
+    channel.write_ctrl = CacheTree()
+    PersistConfig(channel, options)
+    RowPlacementConfig(channel, mem_ctrls[i], options)
 
-    xbar.mem_side_ports = system.sec_ctrl.cpu_side_port
-    system.sec_ctrl.read_port = \
-            system.read_ctrl.cpu_side_port
-    system.sec_ctrl.write_port = \
-            system.write_ctrl.cpu_side_port
-    system.meta_bus.cpu_side_ports = [
-            system.write_ctrl.mem_side_port,
-            system.read_ctrl.mem_side_port
+    channel.sec_ctrl.cpu_side_port = upstream
+    channel.sec_ctrl.read_port = \
+            channel.read_ctrl.cpu_side_port
+    channel.sec_ctrl.write_port = \
+            channel.write_ctrl.cpu_side_port
+    channel.sec_ctrl.write_ctrl = channel.write_ctrl
+    channel.meta_bus.cpu_side_ports = [
+            channel.write_ctrl.mem_side_port,
+            channel.read_ctrl.mem_side_port
             ]
-    system.meta_bus.mem_side_ports = \
-            system.meta_cache.cpu_side
-    system.mem_bus.cpu_side_ports = [
-            system.write_ctrl.mem_bypass_port,
-            system.meta_cache.mem_side,
-            system.sec_ctrl.mem_side_port
+    channel.meta_bus.mem_side_ports = \
+            channel.meta_cache.cpu_side
+    channel.mem_bus.cpu_side_ports = [
+            channel.write_ctrl.mem_bypass_port,
+            channel.meta_cache.mem_side,
+            channel.sec_ctrl.mem_side_port
             ]
-    mem_ctrls[i].port = system.mem_bus.mem_side_ports
+    mem_ctrls[i].port = channel.mem_bus.mem_side_ports
+
+cachet_schemes = {
+    "none": NoCachetConfig,
+    "ct": CTConfig,
+    "mt": MTConfig,
+    "cachetree": CacheTreeConfig,
+}
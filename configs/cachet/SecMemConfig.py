@@ -100,6 +100,7 @@ def config_mem(options, system):
     opt_dram_powerdown = getattr(options, "enable_dram_powerdown", None)
     opt_mem_channels_intlv = getattr(options, "mem_channels_intlv", 128)
     opt_xor_low_bit = getattr(options, "xor_low_bit", 0)
+    opt_cachet_scheme = getattr(options, "cachet_scheme", "cachetree")
 
     if opt_mem_type == "HMC_2500_1x32":
         HMChost = HMC.config_hmc_host_ctrl(options, system)
@@ -142,6 +143,9 @@ def config_mem(options, system):
 
     nvm_intfs = []
     mem_ctrls = []
+    # Interleaved range of every controller, each one gets its own
+    # Cachet pipeline protecting the data of that range
+    channel_ranges = []
 
     if opt_elastic_trace_en and not issubclass(intf, m5.objects.SimpleMemory):
         fatal("When elastic trace is enabled, configure mem-type as "
@@ -204,6 +208,7 @@ def config_mem(options, system):
                     mem_ctrl.dram = dram_intf
 
                 mem_ctrls.append(mem_ctrl)
+                channel_ranges.append(dram_intf.range)
 
             elif opt_nvm_type and (not opt_mem_type or range_iter % 2 == 0):
                 nvm_intf = create_mem_intf(n_intf, r, i, nbr_mem_ctrls,
@@ -221,6 +226,7 @@ def config_mem(options, system):
                     mem_ctrl.nvm = nvm_intf
 
                     mem_ctrls.append(mem_ctrl)
+                    channel_ranges.append(nvm_intf.range)
                 else:
                     nvm_intfs.append(nvm_intf)
 
@@ -237,6 +243,8 @@ def config_mem(options, system):
             # for each vault. All vaults are same size.
             mem_ctrls[i].dram.device_size = options.hmc_dev_vault_size
         else:
-            CacheTreeConfig(i, subsystem, xbar, mem_ctrls)
+            cachet_schemes[opt_cachet_scheme](i, subsystem,
+                    xbar.mem_side_ports, mem_ctrls, channel_ranges[i],
+                    options)
 
     subsystem.mem_ctrls = mem_ctrls
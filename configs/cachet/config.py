@@ -21,6 +21,7 @@ from common.FileSystemConfig import config_filesystem
 from common.Caches import *
 from common.cpu2000 import *
 from cachet import SecMemConfig
+from cachet import CachetOptions
 
 def get_processes(args):
     """Interprets provided args and returns a list of processes"""
@@ -78,6 +79,8 @@ parser = argparse.ArgumentParser()
 Options.addCommonOptions(parser)
 Options.addSEOptions(parser)
 
+CachetOptions.addCachetOptions(parser)
+
 if '--ruby' in sys.argv:
     Ruby.define_options(parser)
 
@@ -198,6 +201,8 @@ for i in range(np):
     system.cpu[i].createThreads()
 
 if args.ruby:
+    # Ruby inserts the Cachet channels of --cachet-scheme between its
+    # directories and the memory controllers
     Ruby.create_system(args, False, system)
     assert(args.num_cpus == len(system.ruby._cpu_ports))
 
@@ -0,0 +1,167 @@
+#!/usr/bin/env python3
+# Sweep the Cachet design space over a memory trace. Every point of the
+# grid is a separate trace.py run in its own output directory, and the
+# results are collected into a CSV with the metadata traffic overhead,
+# bandwidth and latencies of every point. The unprotected baseline is run
+# once and the overheads are relative to it.
+#
+# Example:
+#   configs/cachet/sweep.py --gem5 build/X86/gem5.opt --trace mem.trc.gz \
+#       --schemes ct,cachetree --meta-cache-sizes 32kB,128kB \
+#       --jobs 16 -- --mem-size 32GiB
+
+import argparse
+import csv
+import itertools
+import os
+import re
+import subprocess
+import sys
+from concurrent.futures import ThreadPoolExecutor
+
+trace_config = os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                            "trace.py")
+
+def parse_stats(path):
+    """Read the first stats dump of a run into a name to value dict"""
+    stats = {}
+    with open(path) as f:
+        for line in f:
+            if line.startswith("---------- End"):
+                break
+            fields = line.split()
+            if len(fields) < 2 or fields[0].startswith("-"):
+                continue
+            try:
+                stats[fields[0]] = float(fields[1])
+            except ValueError:
+                pass
+    return stats
+
+def sum_stats(stats, pattern):
+    regex = re.compile(pattern)
+    return sum(v for k, v in stats.items() if regex.match(k))
+
+def summarize(stats):
+    player_bytes = stats.get("system.player.bytesRead", 0) + \
+        stats.get("system.player.bytesWritten", 0)
+    mem_bytes = sum_stats(stats,
+            r"system\.mem_ctrls\d*\.bytes(ReadSys|WrittenSys)$")
+    meta_bursts = sum_stats(stats,
+            r"system\.mem_ctrls\d*\.dram\.meta(Read|Write)Bursts$")
+    meta_row_hits = sum_stats(stats,
+            r"system\.mem_ctrls\d*\.dram\.meta(Read|Write)RowHits$")
+    return {
+        "sim_ticks": stats.get("simTicks", 0),
+        "player_bytes": player_bytes,
+        "mem_bytes": mem_bytes,
+        "traffic_overhead": mem_bytes / player_bytes - 1
+            if player_bytes else 0,
+        "bandwidth": stats.get("system.player.bandwidth", 0),
+        "read_latency": stats.get("system.player.readLatency::mean", 0),
+        "write_latency": stats.get("system.player.writeLatency::mean", 0),
+        # The channels recover in parallel
+        "recovery_ticks": max([v for k, v in stats.items() if re.match(
+            r"system\.cachet\d+\.write_ctrl\.persistTracker\."
+            r"recoveryTicks$", k)], default=0),
+        "barrier_ticks": sum_stats(stats,
+            r"system\.cachet\d+\.write_ctrl\.persistTracker\."
+            r"barrierTicks$"),
+        "meta_row_hit_rate": meta_row_hits / meta_bursts
+            if meta_bursts else 0,
+    }
+
+def run(args, point, extra):
+    name = "_".join("%s-%s" % (k, v) for k, v in point.items())
+    outdir = os.path.join(args.outdir, name)
+    cmd = [args.gem5, "-d", outdir, trace_config, "--trace", args.trace]
+    for key, value in point.items():
+        if isinstance(value, bool):
+            if value:
+                cmd.append("--%s" % key.replace("_", "-"))
+        elif value is not None:
+            cmd += ["--%s" % key.replace("_", "-"), str(value)]
+    cmd += extra
+
+    with open(os.path.join(args.outdir, name + ".log"), "w") as log:
+        ret = subprocess.call(cmd, stdout=log, stderr=subprocess.STDOUT)
+    if ret != 0:
+        print("%s failed, see %s.log" % (name, name), file=sys.stderr)
+        return point, None
+    return point, summarize(parse_stats(os.path.join(outdir,
+                                                     "stats.txt")))
+
+def split(value, conv=str):
+    return [conv(v) for v in value.split(",")] if value else [None]
+
+parser = argparse.ArgumentParser(
+        description="Sweep Cachet configurations over a memory trace. "
+        "Arguments after -- are passed to trace.py.")
+parser.add_argument("--gem5", required=True, help="gem5 binary")
+parser.add_argument("--trace", required=True,
+                    help="Memory trace in the packet.proto format")
+parser.add_argument("--outdir", default="cachet_sweep",
+                    help="Directory of the runs and of results.csv")
+parser.add_argument("--schemes", default="ct,mt,cachetree")
+parser.add_argument("--counter-arities", default=None)
+parser.add_argument("--tree-arities", default=None)
+parser.add_argument("--meta-cache-sizes", default=None)
+parser.add_argument("--meta-compressions", default=None,
+                    help="Comma separated counter compression ratios of "
+                    "the meta cache, with --split-counters 1")
+parser.add_argument("--split-counters", default="0",
+                    help="Comma separated list of 0/1")
+parser.add_argument("--meta-row-placement", default="0",
+                    help="Comma separated list of 0/1")
+parser.add_argument("--persist-modes", default=None,
+                    help="Comma separated list of none/strict/shadow, "
+                    "with an NVM backing given after --")
+parser.add_argument("--jobs", type=int, default=os.cpu_count())
+
+argv = sys.argv[1:]
+extra = []
+if "--" in argv:
+    extra = argv[argv.index("--") + 1:]
+    argv = argv[:argv.index("--")]
+args = parser.parse_args(argv)
+os.makedirs(args.outdir, exist_ok=True)
+
+axes = {
+    "cachet_scheme": split(args.schemes),
+    "counter_arity": split(args.counter_arities, int),
+    "tree_arity": split(args.tree_arities, int),
+    "meta_cache_size": split(args.meta_cache_sizes),
+    "meta_compression": split(args.meta_compressions, int),
+    "split_counters": split(args.split_counters, lambda v: v == "1"),
+    "persist_mode": split(args.persist_modes),
+    "meta_row_placement": split(args.meta_row_placement,
+                                lambda v: v == "1"),
+}
+points = [{"cachet_scheme": "none"}]
+points += [dict(zip(axes.keys(), values))
+           for values in itertools.product(*axes.values())]
+
+with ThreadPoolExecutor(max_workers=args.jobs) as pool:
+    results = list(pool.map(lambda p: run(args, p, extra), points))
+
+baseline = results[0][1]
+fields = list(axes.keys()) + ["sim_ticks", "player_bytes", "mem_bytes",
+        "traffic_overhead", "bandwidth", "read_latency", "write_latency",
+        "recovery_ticks", "barrier_ticks", "meta_row_hit_rate", "slowdown",
+        "read_latency_overhead"]
+with open(os.path.join(args.outdir, "results.csv"), "w") as f:
+    writer = csv.DictWriter(f, fieldnames=fields)
+    writer.writeheader()
+    for point, summary in results:
+        if summary is None:
+            continue
+        row = dict(point)
+        row.update(summary)
+        if baseline:
+            row["slowdown"] = summary["sim_ticks"] / baseline["sim_ticks"]
+            if baseline["read_latency"]:
+                row["read_latency_overhead"] = summary["read_latency"] / \
+                    baseline["read_latency"] - 1
+        writer.writerow(row)
+
+print("Results in %s" % os.path.join(args.outdir, "results.csv"))
@@ -0,0 +1,55 @@
+# Replay a packet.proto memory trace straight into the Cachet channels,
+# without CPUs or caches, to evaluate a configuration quickly. The trace
+# can be recorded with a CommMonitor placed in front of the memory of a
+# full simulation. See sweep.py to run a whole design space.
+
+import argparse
+
+import m5
+from m5.objects import *
+from m5.util import addToPath
+
+addToPath('../')
+
+from common import Options
+from cachet import SecMemConfig
+from cachet import CachetOptions
+
+parser = argparse.ArgumentParser()
+Options.addCommonOptions(parser)
+CachetOptions.addCachetOptions(parser)
+
+parser.add_argument("--trace", required=True,
+                    help="Memory trace in the packet.proto format")
+parser.add_argument("--max-outstanding", type=int, default=16,
+                    help="Maximum number of trace requests in flight")
+parser.add_argument("--untimed", action="store_true",
+                    help="Issue the trace back to back instead of at its "
+                    "recorded ticks")
+
+args = parser.parse_args()
+
+system = System(mem_mode = 'timing',
+                mem_ranges = [AddrRange(args.mem_size)],
+                cache_line_size = args.cacheline_size)
+
+system.voltage_domain = VoltageDomain(voltage = args.sys_voltage)
+system.clk_domain = SrcClockDomain(clock = args.sys_clock,
+                                   voltage_domain = system.voltage_domain)
+
+system.membus = SystemXBar()
+system.system_port = system.membus.cpu_side_ports
+
+system.player = TracePlayer(trace_file = args.trace,
+                            max_outstanding = args.max_outstanding,
+                            timed = not args.untimed)
+system.player.port = system.membus.cpu_side_ports
+
+SecMemConfig.config_mem(args, system)
+
+root = Root(full_system = False, system = system)
+m5.instantiate()
+
+exit_event = m5.simulate()
+print('Exiting @ tick %i because %s' %
+      (m5.curTick(), exit_event.getCause()))
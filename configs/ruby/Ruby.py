@@ -113,6 +113,17 @@ def setup_memory_controllers(system, ruby, dir_cntrls, options):
     mem_ctrls = []
     crossbars = []
 
+    # A Cachet pipeline can sit between every directory and its memory
+    # controllers, see configs/cachet
+    cachet_scheme = None
+    if getattr(options, "cachet_scheme", None):
+        from cachet.Scheme import cachet_schemes
+        cachet_scheme = cachet_schemes[options.cachet_scheme]
+        # The metadata is tracked per cache line
+        if ruby.block_size_bytes != options.cacheline_size:
+            fatal("Cachet needs Ruby blocks of a cache line, "
+                  "drop --numa-high-bit")
+
     if options.numa_high_bit:
         dir_bits = int(math.log(options.num_dirs, 2))
         intlv_size = 2 ** (options.numa_high_bit - dir_bits + 1)
@@ -150,9 +161,14 @@ def setup_memory_controllers(system, ruby, dir_cntrls, options):
             dir_ranges.append(dram_intf.range)
 
             if crossbar != None:
-                mem_ctrl.port = crossbar.mem_side_ports
+                upstream = crossbar.mem_side_ports
+            else:
+                upstream = dir_cntrl.memory_out_port
+            if cachet_scheme:
+                cachet_scheme(len(mem_ctrls) - 1, system, upstream,
+                              mem_ctrls, dram_intf.range, options)
             else:
-                mem_ctrl.port = dir_cntrl.memory_out_port
+                mem_ctrl.port = upstream
 
             # Enable low-power DRAM states if option is set
             if issubclass(mem_type, DRAMInterface):
@@ -1,5 +1,90 @@
 from m5.params import *
+from m5.proxy import *
 from m5.SimObject import SimObject
+from m5.objects.ClockedObject import ClockedObject
+from m5.objects.Tags import BaseSetAssoc, CompressedTags
+from m5.objects.Compressors import BaseCacheCompressor
+
+class PersistMode(ScopedEnum):
+    vals = ['none', 'strict', 'shadow']
+
+class IntegrityLayout(SimObject):
+    type = 'IntegrityLayout'
+    cxx_header = "cachet/integrity_layout.hh"
+    cxx_class = 'gem5::IntegrityLayout'
+
+    protected_size = Param.MemorySize('16GiB',
+            "Size of the protected data, metadata is placed right after it")
+    block_size = Param.Unsigned(64, "Size of a metadata block in bytes")
+    mac_size = Param.Unsigned(8, "Size of the MAC of a data block in bytes")
+    mac_in_ecc = Param.Bool(False, "The MAC travels with its data block, "
+            "in the ECC bits or as extra burst bytes, and has no region")
+    counter_arity = Param.Unsigned(64,
+            "Number of data blocks covered by one counter block")
+    tree_arity = Param.Unsigned(8, "Arity of the Merkle tree")
+    split_counters = Param.Bool(False, "Encode each counter block as a "
+            "shared major counter and one minor counter per data block")
+    major_counter_bits = Param.Unsigned(64, "Width of a major counter")
+    minor_counter_bits = Param.Unsigned(7, "Width of a minor counter, "
+            "an overflow re-encrypts every block of the counter block")
+    channel_range = Param.AddrRange(AllMemory,
+            "Interleaved range of the memory channel holding this tree, "
+            "the metadata of the channel's data is kept in the channel")
+    shadow_entries = Param.Unsigned(0, "Entries of the table tracking "
+            "the tree nodes dirty in the meta cache, placed after the root")
+    row_data_bytes = Param.Unsigned(0, "Data bytes of a DRAM row when "
+            "the DRAM keeps the MACs in the rows of their data, see "
+            "DRAMInterface.row_data_bytes, 0 if it does not")
+
+class MetaTags(BaseSetAssoc):
+    type = 'MetaTags'
+    cxx_header = "cachet/meta_tags.hh"
+    cxx_class = 'gem5::MetaTags'
+
+    layout = Param.IntegrityLayout(Parent.any,
+            "Layout telling the kind of metadata of an address")
+    mac_ways = Param.Unsigned(0, "Ways of a set the MACs may hold, "
+            "0 for no cap")
+    counter_ways = Param.Unsigned(0, "Ways of a set the counters may hold, "
+            "0 for no cap")
+    tree_ways = Param.Unsigned(0, "Ways of a set the tree nodes may hold, "
+            "0 for no cap")
+    keep_upper_levels = Param.Bool(True, "Only evict blocks of the level "
+            "of the miss or below when the set has one")
+
+class MetaCompressedTags(CompressedTags):
+    type = 'MetaCompressedTags'
+    cxx_header = "cachet/meta_compressed_tags.hh"
+    cxx_class = 'gem5::MetaCompressedTags'
+
+    layout = Param.IntegrityLayout(Parent.any,
+            "Layout telling the counter blocks apart")
+
+class CounterCompressor(BaseCacheCompressor):
+    type = 'CounterCompressor'
+    cxx_header = "cachet/counter_compressor.hh"
+    cxx_class = 'gem5::CounterCompressor'
+
+    layout = Param.IntegrityLayout(Parent.any,
+            "Layout giving the packing of the split counters")
+
+    chunk_size_bits = 64
+    # Every field of the block is compared with the base at once
+    comp_chunks_per_cycle = 8 * Self.block_size / Self.chunk_size_bits
+    comp_extra_latency = 1
+    decomp_chunks_per_cycle = 8 * Self.block_size / Self.chunk_size_bits
+    decomp_extra_latency = 1
+
+class HashEngine(ClockedObject):
+    type = 'HashEngine'
+    cxx_header = "cachet/hash_engine.hh"
+    cxx_class = 'gem5::HashEngine'
+
+    lanes = Param.Unsigned(1, "Number of independent hash lanes")
+    pipeline_depth = Param.Unsigned(40,
+            "Latency of one hash operation in cycles")
+    initiation_interval = Param.Unsigned(1,
+            "Cycles between two operations issued to the same lane")
 
 class BaseCtrl(SimObject):
     type = 'BaseCtrl'
@@ -9,6 +94,21 @@ class BaseCtrl(SimObject):
     cpu_side_port = ResponsePort("CPU side port")
     mem_side_port = RequestPort("Memory side port")
 
+    layout = Param.IntegrityLayout(Parent.any, "Integrity metadata layout")
+    hash_engine = Param.HashEngine(Parent.any, "Hash/MAC engine")
+
+class MetaPrefetcher(BaseCtrl):
+    type = 'MetaPrefetcher'
+    cxx_header = "cachet/meta_prefetcher.hh"
+    cxx_class = 'gem5::MetaPrefetcher'
+
+    degree = Param.Unsigned(4, "Number of MAC lines fetched ahead of a "
+            "data stream, along with their counters")
+    prefetch_tree = Param.Bool(False,
+            "Also prefetch the leaf tree node of every prefetched counter")
+    filter_entries = Param.Unsigned(32,
+            "Recently prefetched lines tracked to drop duplicates")
+
 class SecCtrl(BaseCtrl):
     type = 'SecCtrl'
     cxx_header = "cachet/sec_ctrl.hh"
@@ -17,16 +117,62 @@ class SecCtrl(BaseCtrl):
     read_port = RequestPort("Read port")
     write_port = RequestPort("Write port")
 
+    transaction_entries = Param.Unsigned(16,
+            "Number of in-flight transactions")
+    block_size = Param.Unsigned(Parent.cache_line_size,
+            "Block size in bytes used for same-address ordering")
+    prefetcher = Param.MetaPrefetcher(NULL,
+            "Metadata prefetcher fed with the data accesses")
+
+    speculative = Param.Bool(False, "Forward read data before it is "
+            "verified and verify it in the background")
+    verification_window = Param.Unsigned(8,
+            "Maximum number of forwarded reads waiting for verification")
+
+    write_buffer_entries = Param.Unsigned(0, "Entries of the posted write "
+            "buffer, 0 to start every write right away")
+    write_high_watermark = Param.Unsigned(12, "Buffered writes at which "
+            "the buffer starts draining ahead of the reads")
+    write_low_watermark = Param.Unsigned(4, "Buffered writes at which "
+            "the buffer stops draining ahead of the reads")
+    buffer_latency = Param.Latency('1ns', "Latency of acknowledging a "
+            "write or serving a read from the write buffer")
+
+    aes_engine = Param.HashEngine(NULL, "Pipelined AES engine generating "
+            "the counter-mode pads, no decryption is modelled if unset")
+    write_ctrl = Param.BaseCtrl(NULL, "Controller of the metadata writes, "
+            "which may hold the data writes during a re-encryption burst")
+
+    verify_data = Param.Bool(False, "Compute real MACs and tree hashes "
+            "over the data and check them on every read")
+    mac_key = Param.UInt64(0x5ec0de5ec0de, "Key of the functional MACs")
+    halt_on_violation = Param.Bool(True, "Exit the simulation on an "
+            "integrity violation instead of only counting it")
+    fault_addr = Param.Addr(MaxAddr, "Data, counter or tree node address "
+            "corrupted at fault_tick, MaxAddr for none")
+    fault_tick = Param.Tick(0, "Tick at which fault_addr is corrupted")
+
+    protected_ranges = VectorParam.AddrRange([], "Data regions that are "
+            "verified and updated, all the protected data if empty, the "
+            "other accesses go straight to memory")
+
 class CTRead(BaseCtrl):
     type = 'CTRead'
     cxx_header = "cachet/ct_read.hh"
     cxx_class = 'gem5::CTRead'
 
+    parallel_walk = Param.Bool(False, "Issue all levels of the "
+            "verification walk at once and verify them bottom-up")
+    walk_entries = Param.Unsigned(16, "Number of verification walks in "
+            "flight")
+
 class CTWrite(BaseCtrl):
     type = 'CTWrite'
     cxx_header = "cachet/ct_write.hh"
     cxx_class = 'gem5::CTWrite'
 
+    update_entries = Param.Unsigned(16, "Number of tree updates in flight")
+
 class MTWrite(BaseCtrl):
     type = 'MTWrite'
     cxx_header = "cachet/mt_write.hh"
@@ -34,6 +180,17 @@ class MTWrite(BaseCtrl):
 
     mem_bypass_port = RequestPort("Memory bypass port")
 
+    dirty_buffer_entries = Param.Unsigned(0, "Counters whose tree update "
+            "is deferred and coalesced, 0 propagates every write to the root")
+
+    persist_mode = Param.PersistMode('none', "Crash consistency of the "
+            "tree with an NVM backing: none, strict write-through of the "
+            "updated nodes, or shadow tracking of the dirty nodes")
+    root_persist_latency = Param.Latency('10ns', "Latency of persisting "
+            "a root update in its non-volatile register")
+    recovery_block_time = Param.Latency('1ns', "Average time to read one "
+            "metadata block during the recovery, bandwidth bound")
+
 class CacheTree(MTWrite):
     type = 'CacheTree'
     cxx_header = "cachet/cache_tree.hh"
@@ -0,0 +1,17 @@
+from m5.params import *
+from m5.proxy import *
+from m5.objects.ClockedObject import ClockedObject
+
+class TracePlayer(ClockedObject):
+    type = 'TracePlayer'
+    cxx_header = "cachet/trace_player.hh"
+    cxx_class = 'gem5::TracePlayer'
+
+    port = RequestPort("Port sending the trace accesses to memory")
+    system = Param.System(Parent.any, "System the player belongs to")
+
+    trace_file = Param.String("Trace in the packet.proto format")
+    max_outstanding = Param.Unsigned(16,
+            "Maximum number of requests in flight")
+    timed = Param.Bool(True, "Issue the accesses at the ticks of the "
+            "trace, otherwise back to back")
@@ -2,6 +2,8 @@
 
 #include "base/trace.hh"
 #include "debug/BaseCtrl.hh"
+#include "debug/Drain.hh"
+#include "sim/cur_tick.hh"
 
 namespace gem5
 {
@@ -10,7 +12,11 @@ BaseCtrl::BaseCtrl(const BaseCtrlParams &p) :
     SimObject(p),
     finishOperation([this]{ processFinishOperation(); }, name()),
     cpuSidePort(name() + ".cpu_side_port", this),
-    memSidePort(name() + ".mem_side_port", this)
+    memSidePort(name() + ".mem_side_port", this),
+    layout(p.layout),
+    hashEngine(p.hash_engine),
+    packetPool(p.layout->getBlockSize()),
+    stats(*this)
 {
     DPRINTF(BaseCtrl, "Constructing\n");
 }
@@ -18,7 +24,17 @@ BaseCtrl::BaseCtrl(const BaseCtrlParams &p) :
 void
 BaseCtrl::CPUSidePort::sendPacket(PacketPtr pkt)
 {
-    panic_if(blockedPacket != nullptr, "Should never try to send if blocked!");
+    auto it = ctrl->requestTicks.find(pkt);
+    if (it != ctrl->requestTicks.end()) {
+        ctrl->stats.responses++;
+        ctrl->stats.latency.sample(curTick() - it->second);
+        ctrl->requestTicks.erase(it);
+    }
+
+    if (blockedPacket != nullptr) {
+        packetQueue.push(pkt);
+        return;
+    }
 
     if (!sendTimingResp(pkt)) {
         blockedPacket = pkt;
@@ -56,10 +72,16 @@ BaseCtrl::CPUSidePort::recvFunctional(PacketPtr pkt)
 bool
 BaseCtrl::CPUSidePort::recvTimingReq(PacketPtr pkt)
 {
+    bool needs_response = pkt->needsResponse();
     if (!ctrl->handleRequest(pkt)) {
+        ctrl->stats.retries++;
         needRetry = true;
         return false;
     } else {
+        ctrl->stats.requests++;
+        if (needs_response) {
+            ctrl->requestTicks[pkt] = curTick();
+        }
         return true;
     }
 }
@@ -73,6 +95,14 @@ BaseCtrl::CPUSidePort::recvRespRetry()
     blockedPacket= nullptr;
 
     sendPacket(pkt);
+    while (blockedPacket == nullptr && !packetQueue.empty()) {
+        PacketPtr nextPkt = packetQueue.front();
+        packetQueue.pop();
+        sendPacket(nextPkt);
+    }
+
+    trySendRetry();
+    ctrl->checkDrain();
 }
 
 void
@@ -112,6 +142,7 @@ BaseCtrl::MemSidePort::recvReqRetry()
 
     waitingRetry = false;
     sendPacket(pkt);
+    ctrl->checkDrain();
 }
 
 void
@@ -129,13 +160,42 @@ BaseCtrl::createPkt(
         bool isRead
         )
 {
-    RequestPtr req(new Request(addr, size, flags, requestorId));
     MemCmd cmd = isRead ? MemCmd::ReadReq : MemCmd::WriteReq;
-    PacketPtr retPkt = new Packet(req, cmd);
-    uint8_t *reqData = new uint8_t[size]; // just empty here
-    retPkt->dataDynamic(reqData);
+    // The data buffer comes from the pool and is just empty here
+    return packetPool.allocate(addr, size, flags, requestorId, cmd);
+}
 
-    return retPkt;
+void
+BaseCtrl::destroyPkt(PacketPtr pkt)
+{
+    packetPool.release(pkt);
+    checkDrain();
+}
+
+Tick
+BaseCtrl::reserveHash(unsigned ops)
+{
+    Tick ready = hashEngine->reserve(ops);
+    stats.hashTicks += ready - curTick();
+    return ready;
+}
+
+unsigned
+BaseCtrl::metaIndex(Addr addr) const
+{
+    return layout->isMac(addr) ? 0 : layout->levelOf(addr) + 1;
+}
+
+void
+BaseCtrl::recordMetaResponse(PacketPtr pkt)
+{
+    int depth = pkt->req->getAccessDepth();
+    stats.accessDepth.sample(depth);
+    if (depth == 0) {
+        stats.metaHits[metaIndex(pkt->getAddr())]++;
+    } else {
+        stats.metaMisses[metaIndex(pkt->getAddr())]++;
+    }
 }
 
 void
@@ -144,6 +204,7 @@ BaseCtrl::processFinishOperation()
     DPRINTF(BaseCtrl, "finish process\n");
 
     cpuSidePort.trySendRetry();
+    checkDrain();
 }
 
 bool
@@ -187,7 +248,102 @@ BaseCtrl::getAddrRanges() const
 void
 BaseCtrl::handleRangeChange()
 {
-    cpuSidePort.sendRangeChange();
+    // Controllers only issuing metadata accesses leave the port unbound
+    if (cpuSidePort.isConnected()) {
+        cpuSidePort.sendRangeChange();
+    }
+}
+
+BaseCtrl::BaseCtrlStats::BaseCtrlStats(BaseCtrl &_ctrl) :
+    statistics::Group(&_ctrl),
+    ctrl(_ctrl),
+    ADD_STAT(requests, statistics::units::Count::get(),
+             "Number of accepted requests"),
+    ADD_STAT(retries, statistics::units::Count::get(),
+             "Number of rejected requests that had to be retried"),
+    ADD_STAT(responses, statistics::units::Count::get(),
+             "Number of responses sent back"),
+    ADD_STAT(latency, statistics::units::Tick::get(),
+             "Ticks from accepting a request to sending its response"),
+    ADD_STAT(metaHits, statistics::units::Count::get(),
+             "Metadata accesses hitting in the meta cache per level"),
+    ADD_STAT(metaMisses, statistics::units::Count::get(),
+             "Metadata accesses missing in the meta cache per level"),
+    ADD_STAT(metaHitRate, statistics::units::Ratio::get(),
+             "Meta cache hit rate per level"),
+    ADD_STAT(accessDepth, statistics::units::Count::get(),
+             "Cache levels missed by the metadata accesses"),
+    ADD_STAT(hashTicks, statistics::units::Tick::get(),
+             "Ticks spent waiting for the hash engine")
+{
+}
+
+void
+BaseCtrl::BaseCtrlStats::regStats()
+{
+    using namespace statistics;
+
+    statistics::Group::regStats();
+
+    latency
+        .init(16)
+        .flags(nozero);
+
+    accessDepth
+        .init(8)
+        .flags(nozero);
+
+    // One entry for the MACs, then one per level of the layout
+    const unsigned num_levels = ctrl.layout->numLevels();
+    metaHits
+        .init(num_levels + 1)
+        .flags(nozero | nonan);
+    metaMisses
+        .init(num_levels + 1)
+        .flags(nozero | nonan);
+    metaHitRate.flags(nozero | nonan);
+    metaHitRate = metaHits / (metaHits + metaMisses);
+
+    for (unsigned i = 0; i <= num_levels; i++) {
+        std::string level;
+        if (i == 0) {
+            level = "mac";
+        } else if (i == 1) {
+            level = "cnt";
+        } else if (i == num_levels) {
+            level = "root";
+        } else {
+            level = "mt" + std::to_string(i - 2);
+        }
+        metaHits.subname(i, level);
+        metaMisses.subname(i, level);
+        metaHitRate.subname(i, level);
+    }
+}
+
+bool
+BaseCtrl::isIdle() const
+{
+    // Every metadata packet goes back to the pool on its response
+    return requestTicks.empty() && packetPool.inUse() == 0 &&
+        cpuSidePort.isIdle() && memSidePort.isIdle();
+}
+
+void
+BaseCtrl::checkDrain()
+{
+    if (drainState() == DrainState::Draining && isIdle()) {
+        DPRINTF(Drain, "%s drained\n", name());
+        signalDrainDone();
+    }
+}
+
+DrainState
+BaseCtrl::drain()
+{
+    // Requests already accepted are carried through to the end, the
+    // controller is drained once nothing is left in flight
+    return isIdle() ? DrainState::Drained : DrainState::Draining;
 }
 
 Port &
@@ -1,17 +1,14 @@
 #ifndef __CACHET_BASE_CTRL_HH__
 #define __CACHET_BASE_CTRL_HH__
 
-#define AT_START 0x400000000
-#define MAC_START 0x400040000
-#define CNT_START 0x480040000
-#define MT_START 0x490040000
-#define RT_START 0x4924d2480
-
-#define HASH_CYCLE 40
-#define TICK_PER_CYCLE 1000
-
+#include <functional>
 #include <queue>
+#include <unordered_map>
 
+#include "base/statistics.hh"
+#include "cachet/hash_engine.hh"
+#include "cachet/integrity_layout.hh"
+#include "cachet/packet_pool.hh"
 #include "mem/port.hh"
 #include "mem/request.hh"
 #include "params/BaseCtrl.hh"
@@ -29,18 +26,26 @@ class BaseCtrl : public SimObject
         BaseCtrl *ctrl;
         bool needRetry;
         PacketPtr blockedPacket;
+        std::queue<PacketPtr> packetQueue;
 
       public:
         CPUSidePort(const std::string& name, BaseCtrl* _ctrl):
           ResponsePort(name, _ctrl),
           ctrl(_ctrl),
           needRetry(false),
-          blockedPacket(nullptr)
+          blockedPacket(nullptr),
+          packetQueue()
         {}
 
         void sendPacket(PacketPtr pkt);
         void trySendRetry();
         AddrRangeList getAddrRanges() const override;
+        /** Whether no response is waiting to be sent */
+        bool
+        isIdle() const
+        {
+            return blockedPacket == nullptr && packetQueue.empty();
+        }
 
       protected:
         Tick recvAtomic(PacketPtr pkt) override;
@@ -65,6 +70,8 @@ class BaseCtrl : public SimObject
         {}
 
         void sendPacket(PacketPtr ptr);
+        /** Whether no request is waiting to be sent */
+        bool isIdle() const { return packetQueue.empty(); }
 
       protected:
         bool recvTimingResp(PacketPtr pkt) override;
@@ -79,6 +86,15 @@ class BaseCtrl : public SimObject
             uint16_t requestorid,
             bool isRead
             );
+    void destroyPkt(PacketPtr pkt);
+
+    /** Reserve the hash engine and account for the wait */
+    Tick reserveHash(unsigned ops=1);
+    /** Account for a metadata response coming from the meta cache */
+    void recordMetaResponse(PacketPtr pkt);
+    /** Stat index of a metadata address: MAC, counter, MT layers, root */
+    unsigned metaIndex(Addr addr) const;
+
     virtual void processFinishOperation();
     EventFunctionWrapper finishOperation;
 
@@ -89,9 +105,63 @@ class BaseCtrl : public SimObject
     AddrRangeList getAddrRanges() const;
     void handleRangeChange();
 
+    /**
+     * Whether the data writes to a block have to wait, e.g. while its
+     * counter block is re-encrypted. dataReleased, if set, is called
+     * once they may go.
+     */
+    virtual bool holdsData(Addr block_addr) const { return false; }
+    std::function<void()> dataReleased;
+    /**
+     * Send a data block access of this controller, e.g. a re-encryption
+     * read or write-back, through the port of the data writes so that it
+     * stays in order with them. Set by the secure controller, which hands
+     * the response back to handleResponse. The controller's own port is
+     * used when it is not set.
+     */
+    std::function<void(PacketPtr)> sendData;
+
+    /**
+     * Whether the controller has no work left: no request being
+     * processed and no packet waiting in its ports.
+     */
+    virtual bool isIdle() const;
+    /** Signal the end of a drain once the controller is idle */
+    void checkDrain();
+    DrainState drain() override;
+
     CPUSidePort cpuSidePort;
     MemSidePort memSidePort;
 
+    IntegrityLayout *layout;
+    HashEngine *hashEngine;
+
+    /** Pool of the metadata packets generated by this controller */
+    PacketPool packetPool;
+
+    /** Tick at which each request waiting for a response was accepted */
+    std::unordered_map<PacketPtr, Tick> requestTicks;
+
+    struct BaseCtrlStats : public statistics::Group
+    {
+        BaseCtrlStats(BaseCtrl &ctrl);
+        void regStats() override;
+
+        const BaseCtrl &ctrl;
+
+        statistics::Scalar requests;
+        statistics::Scalar retries;
+        statistics::Scalar responses;
+        statistics::Histogram latency;
+
+        statistics::Vector metaHits;
+        statistics::Vector metaMisses;
+        statistics::Formula metaHitRate;
+        statistics::Histogram accessDepth;
+
+        statistics::Scalar hashTicks;
+    } stats;
+
     BaseCtrl(const BaseCtrlParams &p);
     virtual Port& getPort(const std::string &if_name,
         PortID idx=InvalidPortID) override;
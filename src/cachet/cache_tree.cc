@@ -7,7 +7,8 @@ namespace gem5
 {
 
 CacheTree::CacheTree(const CacheTreeParams &p) :
-    MTWrite(p)
+    MTWrite(p),
+    treeStats(*this)
 {
     DPRINTF(CacheTree, "Constructing\n");
 }
@@ -15,21 +16,50 @@ CacheTree::CacheTree(const CacheTreeParams &p) :
 bool
 CacheTree::handleResponse(PacketPtr pkt)
 {
-    assert(requestPkt);
     DPRINTF(CacheTree, "Got response for %#x\n", pkt->print());
+    if (handleDeferredResponse(pkt)) {
+        return true;
+    }
+    assert(requestPkt);
 
     // Cnt and MT pkt case
-    if (pkt->getAddr() >= CNT_START) {
-        responsePkt = pkt;
-
-        if (pkt->req->getAccessDepth() == 0) {
-            schedule(finishOperation, curTick() + 5*HASH_CYCLE*TICK_PER_CYCLE);
-        } else {
-            schedule(nextMTOperation, curTick() + HASH_CYCLE*TICK_PER_CYCLE);
-        }
+    if (layout->levelOf(pkt->getAddr()) > 0) {
+        // Tree nodes go through the meta cache
+        recordMetaResponse(pkt);
+        persist.nodeUpdated(pkt);
+    }
+    responsePkt = pkt;
+
+    if (pkt->req->getAccessDepth() == 0) {
+        treeStats.stopLevel.sample(layout->levelOf(pkt->getAddr()));
+        schedule(finishOperation, reserveHash(5));
+    } else {
+        schedule(nextMTOperation, reserveHash());
     }
 
     return true;
 }
 
+bool
+CacheTree::stopsFlush(PacketPtr pkt)
+{
+    // A node cached on chip is trusted, so the flush stops there like an
+    // eager update does
+    if (pkt->req->getAccessDepth() == 0) {
+        treeStats.stopLevel.sample(layout->levelOf(pkt->getAddr()));
+        return true;
+    }
+    return false;
+}
+
+CacheTree::CacheTreeStats::CacheTreeStats(CacheTree &ctrl) :
+    statistics::Group(&ctrl),
+    ADD_STAT(stopLevel, statistics::units::Count::get(),
+             "Level of the cached node that ended an update")
+{
+    stopLevel
+        .init(16)
+        .flags(statistics::nozero);
+}
+
 } // namespace gem5
@@ -11,6 +11,14 @@ class CacheTree : public MTWrite
 {
   private:
     bool handleResponse(PacketPtr pkt) override;
+    bool stopsFlush(PacketPtr pkt) override;
+
+    struct CacheTreeStats : public statistics::Group
+    {
+        CacheTreeStats(CacheTree &ctrl);
+
+        statistics::Histogram stopLevel;
+    } treeStats;
 
   public:
     CacheTree(const CacheTreeParams &p);
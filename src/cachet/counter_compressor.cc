@@ -0,0 +1,79 @@
+#include "cachet/counter_compressor.hh"
+
+#include <algorithm>
+
+#include "base/intmath.hh"
+#include "base/logging.hh"
+
+namespace gem5
+{
+
+CounterCompressor::CounterCompressor(const CounterCompressorParams &p) :
+    compression::Base(p),
+    layout(p.layout),
+    widthBits(ceilLog2(p.layout->getMinorCounterBits() + 1)),
+    counterStats(*this)
+{
+    fatal_if(!layout->hasSplitCounters(), "%s: only split counter blocks "
+            "can be compressed", name());
+    fatal_if(blkSize != layout->getBlockSize(), "%s: the cache blocks "
+            "must be the counter blocks", name());
+}
+
+std::unique_ptr<compression::Base::CompressionData>
+CounterCompressor::compress(const std::vector<Chunk> &chunks,
+                            Cycles &comp_lat, Cycles &decomp_lat)
+{
+    std::vector<uint64_t> line(blkSize / sizeof(uint64_t));
+    fromChunks(chunks, line.data());
+    const uint8_t *block = reinterpret_cast<const uint8_t*>(line.data());
+
+    uint64_t base = layout->counterField(block, 1);
+    uint64_t top = base;
+    for (unsigned i = 2; i <= layout->getCounterArity(); i++) {
+        uint64_t minor = layout->counterField(block, i);
+        base = std::min(base, minor);
+        top = std::max(top, minor);
+    }
+    const unsigned width = top == base ? 0 : floorLog2(top - base) + 1;
+    counterStats.deltaWidths[width]++;
+
+    std::unique_ptr<CompressionData> comp_data(new CompData(chunks));
+    comp_data->setSizeBits(layout->getMajorCounterBits() +
+            layout->getMinorCounterBits() + widthBits +
+            layout->getCounterArity() * width);
+
+    // The fields are extracted and compared in parallel
+    comp_lat = Cycles(chunks.size() / compChunksPerCycle +
+            compExtraLatency);
+    decomp_lat = Cycles(chunks.size() / decompChunksPerCycle +
+            decompExtraLatency);
+    return comp_data;
+}
+
+void
+CounterCompressor::decompress(const CompressionData *comp_data,
+                              uint64_t *data)
+{
+    fromChunks(static_cast<const CompData*>(comp_data)->chunks, data);
+}
+
+CounterCompressor::CounterCompressorStats::CounterCompressorStats(
+        CounterCompressor &_compressor) :
+    statistics::Group(&_compressor, "counters"),
+    compressor(_compressor),
+    ADD_STAT(deltaWidths, statistics::units::Count::get(),
+             "Compressed blocks per width of their minor counter deltas")
+{
+}
+
+void
+CounterCompressor::CounterCompressorStats::regStats()
+{
+    statistics::Group::regStats();
+
+    deltaWidths.init(compressor.layout->getMinorCounterBits() + 1);
+    deltaWidths.flags(statistics::nozero);
+}
+
+} // namespace gem5
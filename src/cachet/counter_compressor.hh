@@ -0,0 +1,83 @@
+#ifndef __CACHET_COUNTER_COMPRESSOR_HH__
+#define __CACHET_COUNTER_COMPRESSOR_HH__
+
+#include <memory>
+#include <vector>
+
+#include "base/statistics.hh"
+#include "cachet/integrity_layout.hh"
+#include "mem/cache/compressors/base.hh"
+#include "params/CounterCompressor.hh"
+
+namespace gem5
+{
+
+/**
+ * Compressor of the split counter blocks held in the meta cache.
+ *
+ * The minor counters of a counter block are bumped by the writes to
+ * neighbouring data and usually stay close to each other, so they are
+ * stored as deltas from a shared base, the smallest of them. A
+ * compressed block holds the major counter, the base, the width of the
+ * deltas and one delta per minor counter, all deltas having the width of
+ * the largest one. This is the base+delta scheme of the BaseDelta
+ * compressors applied to the counter fields: the minor counters are
+ * packed across the 64-bit words, which word-granular patterns cannot
+ * see.
+ *
+ * Only the counter blocks are compressed, the MACs and tree nodes stay
+ * uncompressed and pay no decompression latency.
+ */
+class CounterCompressor : public compression::Base
+{
+  private:
+    class CompData;
+
+    IntegrityLayout *layout;
+    /** Bits of the header giving the width of the deltas */
+    const unsigned widthBits;
+
+    struct CounterCompressorStats : public statistics::Group
+    {
+        CounterCompressorStats(CounterCompressor &compressor);
+
+        void regStats() override;
+
+        CounterCompressor &compressor;
+
+        statistics::Vector deltaWidths;
+    } counterStats;
+
+  protected:
+    std::unique_ptr<CompressionData> compress(
+        const std::vector<Chunk> &chunks, Cycles &comp_lat,
+        Cycles &decomp_lat) override;
+
+    void decompress(const CompressionData *comp_data,
+                    uint64_t *data) override;
+
+  public:
+    CounterCompressor(const CounterCompressorParams &p);
+
+    bool
+    compressible(Addr addr) const override
+    {
+        return layout->isCounter(addr);
+    }
+};
+
+class CounterCompressor::CompData : public CompressionData
+{
+  public:
+    /** Decompression only has to give the original block back */
+    std::vector<Chunk> chunks;
+
+    CompData(const std::vector<Chunk> &chunks) :
+        CompressionData(), chunks(chunks)
+    {
+    }
+};
+
+} // namespace gem5
+
+#endif // __CACHET_COUNTER_COMPRESSOR_HH__
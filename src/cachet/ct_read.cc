@@ -1,5 +1,7 @@
 #include "cachet/ct_read.hh"
 
+#include <algorithm>
+
 #include "base/trace.hh"
 #include "debug/CTRead.hh"
 
@@ -8,135 +10,319 @@ namespace gem5
 
 CTRead::CTRead(const CTReadParams &p) :
     BaseCtrl(p),
-    blocked(false),
-    responcePkt(nullptr)
+    walkEntries(p.walk_entries),
+    parallelWalk(p.parallel_walk),
+    readStats(*this)
 {
     DPRINTF(CTRead, "Constructing\n");
+    fatal_if(walkEntries == 0, "%s needs at least one walk entry", name());
+}
+
+void
+CTRead::scheduleFinish(Walk *walk)
+{
+    Tick when = reserveHash();
+    finishQueue.emplace(when, walk);
+    if (!finishOperation.scheduled()) {
+        schedule(finishOperation, when);
+    } else if (when < finishOperation.when()) {
+        reschedule(finishOperation, when);
+    }
 }
 
 void
 CTRead::processFinishOperation() {
-    blocked = false;
-    cpuSidePort.sendPacket(responcePkt);
-    responcePkt = nullptr;
+    while (!finishQueue.empty() && finishQueue.begin()->first <= curTick()) {
+        Walk *walk = finishQueue.begin()->second;
+        finishQueue.erase(finishQueue.begin());
+        walk->requestPkt->makeResponse();
+        cpuSidePort.sendPacket(walk->requestPkt);
+        walks.remove_if([walk](const Walk &w){ return &w == walk; });
+    }
+    if (!finishQueue.empty()) {
+        schedule(finishOperation, finishQueue.begin()->first);
+    }
     cpuSidePort.trySendRetry();
-    return;
+    checkDrain();
+}
+
+bool
+CTRead::isIdle() const
+{
+    return walks.empty() && walkOf.empty() && BaseCtrl::isIdle();
+}
+
+bool
+CTRead::needsCounter(const Walk *walk) const
+{
+    return walk->requestPkt->findNextSenderState<CounterReadyState>();
+}
+
+void
+CTRead::counterArrived(Walk *walk)
+{
+    auto *state =
+        walk->requestPkt->findNextSenderState<CounterReadyState>();
+    if (state) {
+        state->counterReady();
+    }
+}
+
+void
+CTRead::sendWalkPkt(Walk *walk, PacketPtr pkt)
+{
+    walkOf[pkt] = walk;
+    memSidePort.sendPacket(pkt);
 }
 
 bool
 CTRead::handleRequest(PacketPtr pkt)
 {
-    if (blocked) {
+    if (walks.size() >= walkEntries) {
         return false;
     }
 
     panic_if(
-            pkt->getAddr() >= AT_START,
-            "Data pkt whose address is over 16GiB"
+            !layout->isData(pkt->getAddr()),
+            "Data pkt whose address is outside of the protected region"
             );
     DPRINTF(CTRead, "Got request for %#x\n", pkt->print());
 
-    blocked = true;
-    Addr offset = pkt->getAddr() >> 8 << 5;
-    PacketPtr macPkt = createPkt(
-            MAC_START + offset,
-            8,
+    walks.emplace_back();
+    Walk *walk = &walks.back();
+    walk->requestPkt = pkt;
+    readStats.walks++;
+    if (parallelWalk) {
+        sendParallelWalk(walk);
+        return true;
+    }
+
+    // Without a separate MAC, the walk starts at the counter
+    bool mac_in_ecc = layout->hasMacInEcc();
+    PacketPtr metaPkt = createPkt(
+            mac_in_ecc ? layout->counterAddr(pkt->getAddr()) :
+                layout->macAddr(pkt->getAddr()),
+            mac_in_ecc ? layout->getBlockSize() : layout->getMacSize(),
             pkt->req->getFlags(),
             pkt->req->requestorId(),
             true
             );
-    memSidePort.sendPacket(macPkt);
+    walk->levels = 1;
+    sendWalkPkt(walk, metaPkt);
+    return true;
+}
+
+void
+CTRead::sendParallelWalk(Walk *walk)
+{
+    PacketPtr pkt = walk->requestPkt;
+
+    // Compute every ancestor of the data block up front: MAC, counter,
+    // each MT layer and finally the root
+    if (!layout->hasMacInEcc()) {
+        walk->pkts.push_back(createPkt(
+                layout->macAddr(pkt->getAddr()),
+                layout->getMacSize(),
+                pkt->req->getFlags(),
+                pkt->req->requestorId(),
+                true
+                ));
+    }
+
+    Addr addr = layout->counterAddr(pkt->getAddr());
+    while (true) {
+        walk->pkts.push_back(createPkt(
+                addr,
+                layout->getBlockSize(),
+                pkt->req->getFlags(),
+                pkt->req->requestorId(),
+                true
+                ));
+        if (layout->isRoot(addr)) {
+            break;
+        }
+        addr = layout->parentAddr(addr);
+    }
+
+    walk->arrived.assign(walk->pkts.size(), false);
+    walk->hit.assign(walk->pkts.size(), false);
+    for (auto walkPkt : walk->pkts) {
+        sendWalkPkt(walk, walkPkt);
+    }
+}
+
+bool
+CTRead::handleParallelWalkResponse(Walk *walk, PacketPtr pkt)
+{
+    if (!walk) {
+        // Ancestor of an already verified walk, nothing to do
+        DPRINTF(CTRead, "Drop stale walk response for %#x\n", pkt->print());
+        readStats.unusedFetches++;
+        destroyPkt(pkt);
+        return true;
+    }
+
+    const size_t level = std::find(walk->pkts.begin(), walk->pkts.end(),
+            pkt) - walk->pkts.begin();
+    assert(level < walk->pkts.size());
+
+    DPRINTF(CTRead, "Got walk response for level %d\n", level);
+    // The counter comes right after the MAC, if any
+    const size_t counter_level = layout->hasMacInEcc() ? 0 : 1;
+    if (level == counter_level) {
+        counterArrived(walk);
+    }
+    walk->arrived[level] = true;
+    walk->hit[level] = pkt->req->getAccessDepth() == 0;
+    walk->pkts[level] = nullptr;
+    destroyPkt(pkt);
+
+    // Verify bottom-up: the walk is done once every level up to the
+    // first trusted one, i.e. cached or the root, has arrived, and the
+    // counter too when a pad waits for it
+    if (needsCounter(walk) && !walk->arrived[counter_level]) {
+        return true;
+    }
+    for (size_t i = 0; i < walk->pkts.size(); i++) {
+        if (!walk->arrived[i]) {
+            return true;
+        }
+        if (walk->hit[i] || i + 1 == walk->pkts.size()) {
+            DPRINTF(CTRead, "Walk verified at level %d\n", i);
+            readStats.walkLevels.sample(i + 1);
+            // The fetches still in flight are now stale
+            for (auto walkPkt : walk->pkts) {
+                if (walkPkt) {
+                    walkOf[walkPkt] = nullptr;
+                }
+            }
+            scheduleFinish(walk);
+            return true;
+        }
+    }
+
     return true;
 }
 
 bool
 CTRead::handleResponse(PacketPtr pkt)
 {
-    assert(blocked);
+    auto it = walkOf.find(pkt);
+    assert(it != walkOf.end());
+    Walk *walk = it->second;
+    walkOf.erase(it);
+
+    recordMetaResponse(pkt);
+    if (parallelWalk) {
+        return handleParallelWalkResponse(walk, pkt);
+    }
+
     DPRINTF(CTRead, "Got response for %#x\n", pkt->print());
 
-    if (pkt->req->getAccessDepth() == 0) {
+    bool is_mac = layout->isMac(pkt->getAddr());
+    if (!is_mac && layout->levelOf(pkt->getAddr()) == 0) {
+        counterArrived(walk);
+    }
+
+    // A cached MAC ends the walk, unless a pad needs the counter, which
+    // is then fetched and verified as well
+    if (pkt->req->getAccessDepth() == 0 &&
+            (!is_mac || !needsCounter(walk))) {
         // Cache Hit
-        responcePkt = pkt;
-        schedule(finishOperation, curTick() + HASH_CYCLE * TICK_PER_CYCLE);
-        return true;
+        readStats.walkLevels.sample(walk->levels);
+        scheduleFinish(walk);
+    } else if (layout->isRoot(pkt->getAddr())) {
+        // Root
+        readStats.walkLevels.sample(walk->levels);
+        scheduleFinish(walk);
     } else {
-        if (pkt->getAddr() < CNT_START) {
-            Addr offset = (pkt->getAddr() - MAC_START) >> 11 << 8;
-            PacketPtr cntPkt = createPkt(
-                    CNT_START + offset,
-                    64,
-                    pkt->req->getFlags(),
-                    pkt->req->requestorId(),
-                    true
-                    );
-            memSidePort.sendPacket(cntPkt);
-        } else if (pkt->getAddr() < MT_START) {
-            Addr offset = (pkt->getAddr() - CNT_START) >> 11 << 8;
-            PacketPtr mtPkt = createPkt(
-                    MT_START + offset,
-                    64,
-                    pkt->req->getFlags(),
-                    pkt->req->requestorId(),
-                    true
-                    );
-            memSidePort.sendPacket(mtPkt);
+        Addr addr;
+        if (is_mac) {
+            addr = layout->counterAddr(walk->requestPkt->getAddr());
         } else {
-            Addr layer_start = MT_START;
-            Addr layer_size = 0x10000000 >> 3;
-            for (int i=0; i<10; i++) {
-                if (layer_start == RT_START) {
-                    // Root
-                    responcePkt = pkt;
-                    schedule(
-                            finishOperation,
-                            curTick() + HASH_CYCLE * TICK_PER_CYCLE
-                            );
-                    return true;
-                }
-
-                if (pkt->getAddr() < layer_start+layer_size) {
-                    // Layer 0 is the leaf of MT
-                    DPRINTF(CTRead, "send pkt in layer %d\n", i+1);
-                    Addr offset = (pkt->getAddr() - layer_start) >> 11 << 8;
-                    PacketPtr mtPkt = createPkt(
-                            layer_start + layer_size + offset,
-                            64,
-                            pkt->req->getFlags(),
-                            pkt->req->requestorId(),
-                            true
-                            );
-                    memSidePort.sendPacket(mtPkt);
-                    return true;
-                }
-                layer_start += layer_size;
-                layer_size >>= 3;
-            }
-
-            assert(false);
+            addr = layout->parentAddr(pkt->getAddr());
+            DPRINTF(CTRead, "send pkt in level %d\n", layout->levelOf(addr));
         }
+        PacketPtr metaPkt = createPkt(
+                addr,
+                layout->getBlockSize(),
+                pkt->req->getFlags(),
+                pkt->req->requestorId(),
+                true
+                );
+        walk->levels++;
+        sendWalkPkt(walk, metaPkt);
     }
 
+    destroyPkt(pkt);
     return true;
 }
 
 Tick
 CTRead::handleAtomic(PacketPtr pkt)
 {
-    PacketPtr metaPkt = createPkt(
-            AT_START,
-            1,
-            pkt->req->getFlags(),
-            pkt->req->requestorId(),
-            true
-            );
-    return memSidePort.sendAtomic(metaPkt);
+    // Walk the metadata as in timing mode, stopping at the first level
+    // that hits in the meta cache, which also warms the meta cache up.
+    // The levels of a parallel walk overlap, so only the slowest one
+    // counts.
+    Tick latency = 0;
+    unsigned levels = 0;
+    Addr addr;
+    unsigned size;
+    if (layout->hasMacInEcc()) {
+        addr = layout->counterAddr(pkt->getAddr());
+        size = layout->getBlockSize();
+    } else {
+        addr = layout->macAddr(pkt->getAddr());
+        size = layout->getMacSize();
+    }
+    while (true) {
+        PacketPtr metaPkt = createPkt(
+                addr,
+                size,
+                pkt->req->getFlags(),
+                pkt->req->requestorId(),
+                true
+                );
+        Tick meta_latency = memSidePort.sendAtomic(metaPkt);
+        if (parallelWalk) {
+            latency = std::max(latency, meta_latency);
+        } else {
+            latency += meta_latency;
+        }
+        levels++;
+        recordMetaResponse(metaPkt);
+        bool hit = metaPkt->req->getAccessDepth() == 0;
+        destroyPkt(metaPkt);
+
+        if (hit || layout->isRoot(addr)) {
+            break;
+        }
+        if (layout->isMac(addr)) {
+            addr = layout->counterAddr(pkt->getAddr());
+        } else {
+            addr = layout->parentAddr(addr);
+        }
+        size = layout->getBlockSize();
+    }
+
+    readStats.walks++;
+    readStats.walkLevels.sample(levels);
+    return latency + hashEngine->hashLatency();
 }
 
-void
-CTRead::handleFunctional(PacketPtr pkt)
+CTRead::CTReadStats::CTReadStats(CTRead &ctrl) :
+    statistics::Group(&ctrl),
+    ADD_STAT(walks, statistics::units::Count::get(),
+             "Number of verification walks"),
+    ADD_STAT(walkLevels, statistics::units::Count::get(),
+             "Metadata levels needed to verify a block"),
+    ADD_STAT(unusedFetches, statistics::units::Count::get(),
+             "Parallel walk fetches arriving after their walk was verified")
 {
-    memSidePort.sendFunctional(pkt);
+    walkLevels
+        .init(16)
+        .flags(statistics::nozero);
 }
 
 } // namespace gem5
@@ -1,23 +1,90 @@
 #ifndef __CACHET_CT_READ_HH__
 #define __CACHET_CT_READ_HH__
 
+#include <functional>
+#include <list>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
 #include "cachet/base_ctrl.hh"
 #include "params/CTRead.hh"
 
 namespace gem5
 {
 
+/**
+ * Attached by the secure controller to a verification read that needs the
+ * counter of its block to generate the encryption pad. The walk then
+ * always fetches the counter and reports its arrival.
+ */
+struct CounterReadyState : public Packet::SenderState
+{
+    std::function<void()> counterReady;
+
+    CounterReadyState(std::function<void()> counter_ready) :
+        counterReady(counter_ready)
+    {}
+};
+
+/**
+ * Verification walker. Up to walk_entries walks are in flight at a time,
+ * each with its own progress, and a request arriving while they are all
+ * busy is refused and retried once one completes.
+ */
 class CTRead : public BaseCtrl
 {
   private:
+    /** Verification walk of a data read */
+    struct Walk
+    {
+        PacketPtr requestPkt;
+        /** Metadata levels fetched so far */
+        unsigned levels;
+        /** Packets of a parallel walk, from the MAC to the root */
+        std::vector<PacketPtr> pkts;
+        std::vector<bool> arrived;
+        std::vector<bool> hit;
+    };
+
     void processFinishOperation() override;
     bool handleRequest(PacketPtr pkt) override;
     bool handleResponse(PacketPtr pkt) override;
     Tick handleAtomic(PacketPtr pkt) override;
-    void handleFunctional(PacketPtr pkt) override;
+    bool isIdle() const override;
+
+    void sendWalkPkt(Walk *walk, PacketPtr pkt);
+    void sendParallelWalk(Walk *walk);
+    bool handleParallelWalkResponse(Walk *walk, PacketPtr pkt);
+    /** Respond to the request of a walk once its hashes are done */
+    void scheduleFinish(Walk *walk);
+
+    /** Whether a walk has to fetch the counter for a pad */
+    bool needsCounter(const Walk *walk) const;
+    /** Report the counter of a walk, if anyone waits for it */
+    void counterArrived(Walk *walk);
+
+    const unsigned walkEntries;
+    std::list<Walk> walks;
+    /**
+     * Walk of every metadata packet in flight. The parallel fetches
+     * still in flight when their walk is verified map to nullptr.
+     */
+    std::unordered_map<PacketPtr, Walk *> walkOf;
+    /** Verified walks, by the tick their hashes are done */
+    std::multimap<Tick, Walk *> finishQueue;
+
+    /** Issue every level of the walk at once instead of one by one */
+    const bool parallelWalk;
+
+    struct CTReadStats : public statistics::Group
+    {
+        CTReadStats(CTRead &ctrl);
 
-    bool blocked;
-    PacketPtr responcePkt;
+        statistics::Scalar walks;
+        statistics::Histogram walkLevels;
+        statistics::Scalar unusedFetches;
+    } readStats;
 
   public:
     CTRead(const CTReadParams &p);
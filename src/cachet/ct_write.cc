@@ -9,105 +9,172 @@ namespace gem5
 CTWrite::CTWrite(const CTWriteParams &p) :
     BaseCtrl(p),
     requestOperation([this]{ processRequestOperation(); }, name()),
-    requestPkt(nullptr),
-    responsePkt(nullptr),
-    responseTimes(0)
+    updateEntries(p.update_entries),
+    counters(*this, memSidePort),
+    writeStats(*this)
 {
     DPRINTF(CTWrite, "Constructing\n");
+    fatal_if(updateEntries == 0, "%s needs at least one update entry",
+            name());
 }
 
 void
 CTWrite::processFinishOperation()
 {
-    requestPkt = nullptr;
-    responseTimes = 0;
-    cpuSidePort.sendPacket(responsePkt);
-    responsePkt = nullptr;
+    for (auto update : doneUpdates) {
+        update->requestPkt->makeResponse();
+        cpuSidePort.sendPacket(update->requestPkt);
+        updates.remove_if([update](const Update &u){ return &u == update; });
+    }
+    doneUpdates.clear();
     cpuSidePort.trySendRetry();
+    checkDrain();
+}
+
+bool
+CTWrite::isIdle() const
+{
+    return updates.empty() && !counters.busy() && BaseCtrl::isIdle();
+}
+
+void
+CTWrite::serialize(CheckpointOut &cp) const
+{
+    if (counters.enabled()) {
+        counters.serializeSection(cp, "splitCounters");
+    }
+}
+
+void
+CTWrite::unserialize(CheckpointIn &cp)
+{
+    if (counters.enabled()) {
+        counters.unserializeSection(cp, "splitCounters");
+    }
 }
 
 void
 CTWrite::processRequestOperation()
 {
-    Addr offset = requestPkt->getAddr() >> 8 << 5;
-    PacketPtr macPkt = createPkt(
-            MAC_START + offset,
-            8,
-            requestPkt->req->getFlags(),
-            requestPkt->req->requestorId(),
-            false
-            );
-    memSidePort.sendPacket(macPkt);
-
-    offset = (macPkt->getAddr() - MAC_START) >> 11 << 8;
-    PacketPtr cntPkt = createPkt(
-            CNT_START + offset,
-            64,
-            macPkt->req->getFlags(),
-            macPkt->req->requestorId(),
-            false
-            );
-    memSidePort.sendPacket(cntPkt);
-
-    offset = (cntPkt->getAddr() - CNT_START) >> 11 << 8;
-    PacketPtr mtPkt = createPkt(
-            MT_START + offset,
-            64,
-            cntPkt->req->getFlags(),
-            cntPkt->req->requestorId(),
-            false
-            );
-    memSidePort.sendPacket(mtPkt);
+    while (!hashQueue.empty() && hashQueue.begin()->first <= curTick()) {
+        Update *update = hashQueue.begin()->second;
+        hashQueue.erase(hashQueue.begin());
+        sendUpdate(update);
+    }
+    if (!hashQueue.empty()) {
+        schedule(requestOperation, hashQueue.begin()->first);
+    }
+}
+
+void
+CTWrite::sendMetaPkt(Update *update, PacketPtr pkt)
+{
+    writeStats.metaWrites++;
+    writeStats.metaWriteBytes += pkt->getSize();
+    update->responsesLeft++;
+    updateOf[pkt] = update;
+    memSidePort.sendPacket(pkt);
+}
+
+void
+CTWrite::sendUpdate(Update *update)
+{
+    PacketPtr requestPkt = update->requestPkt;
+
+    // A MAC travelling with its data is written along with it
+    if (!layout->hasMacInEcc()) {
+        PacketPtr macPkt = createPkt(
+                layout->macAddr(requestPkt->getAddr()),
+                layout->getMacSize(),
+                requestPkt->req->getFlags(),
+                requestPkt->req->requestorId(),
+                false
+                );
+        sendMetaPkt(update, macPkt);
+    }
 
-    PacketPtr pkt = mtPkt;
-    Addr layer_start = MT_START;
-    Addr layer_size = 0x10000000 >> 3;
-    for (int i=0; i<7; i++) {
-        offset = (pkt->getAddr() - layer_start) >> 11 << 8;
+    // Update the counter and every MT layer up to the root
+    PacketPtr pkt = counters.createCounterPkt(requestPkt);
+    Addr addr = pkt->getAddr();
+    while (true) {
+        sendMetaPkt(update, pkt);
+        if (layout->isRoot(addr)) {
+            break;
+        }
+        addr = layout->parentAddr(addr);
         pkt = createPkt(
-                layer_start + layer_size + offset,
-                64,
-                pkt->req->getFlags(),
-                pkt->req->requestorId(),
+                addr,
+                layout->getBlockSize(),
+                requestPkt->req->getFlags(),
+                requestPkt->req->requestorId(),
                 false
                 );
-        memSidePort.sendPacket(pkt);
-        layer_start += layer_size;
-        layer_size >>= 3;
     }
 }
 
+PacketPtr
+CTWrite::createMetaPkt(PacketPtr pkt)
+{
+    // The counter block is written whole as it carries the counters
+    if (layout->hasMacInEcc()) {
+        return counters.createCounterPkt(pkt);
+    }
+    return createPkt(
+            layout->macAddr(pkt->getAddr()),
+            1,
+            pkt->req->getFlags(),
+            pkt->req->requestorId(),
+            false
+            );
+}
+
 bool
 CTWrite::handleRequest(PacketPtr pkt)
 {
-    if (requestPkt) {
+    if (updates.size() >= updateEntries || counters.busy()) {
         return false;
     }
 
     panic_if(
-            pkt->getAddr() >= AT_START,
-            "Data pkt whose address is over 16GiB"
+            !layout->isData(pkt->getAddr()),
+            "Data pkt whose address is outside of the protected region"
             );
     DPRINTF(CTWrite, "Got request for addr %#x\n", pkt->getAddr());
 
-    requestPkt = pkt;
-    schedule(
-            requestOperation,
-            curTick() + HASH_CYCLE * TICK_PER_CYCLE
-            );
+    updates.push_back({pkt, 0});
+    if (counters.enabled()) {
+        counters.write(pkt);
+    }
+    Tick when = reserveHash();
+    hashQueue.emplace(when, &updates.back());
+    if (!requestOperation.scheduled()) {
+        schedule(requestOperation, when);
+    } else if (when < requestOperation.when()) {
+        reschedule(requestOperation, when);
+    }
     return true;
 }
 
 bool
 CTWrite::handleResponse(PacketPtr pkt)
 {
-    assert(requestPkt);
     DPRINTF(CTWrite, "Got response for %#x\n", pkt->print());
+    if (counters.handleResponse(pkt)) {
+        return true;
+    }
 
-    responseTimes++;
-    if (responseTimes >= 10) {
-        responsePkt = pkt;
-        schedule(finishOperation, curTick());
+    auto it = updateOf.find(pkt);
+    assert(it != updateOf.end());
+    Update *update = it->second;
+    updateOf.erase(it);
+    destroyPkt(pkt);
+
+    // One response for the MAC, if any, and one per level
+    if (--update->responsesLeft == 0) {
+        doneUpdates.push_back(update);
+        if (!finishOperation.scheduled()) {
+            schedule(finishOperation, curTick());
+        }
     }
 
     return true;
@@ -116,27 +183,23 @@ CTWrite::handleResponse(PacketPtr pkt)
 Tick
 CTWrite::handleAtomic(PacketPtr pkt)
 {
-    PacketPtr metaPkt = createPkt(
-            AT_START,
-            1,
-            pkt->req->getFlags(),
-            pkt->req->requestorId(),
-            false
-            );
-    return memSidePort.sendAtomic(metaPkt);
+    if (counters.enabled()) {
+        counters.increment(pkt->getAddr());
+    }
+
+    PacketPtr metaPkt = createMetaPkt(pkt);
+    Tick latency = memSidePort.sendAtomic(metaPkt);
+    destroyPkt(metaPkt);
+    return latency;
 }
 
-void
-CTWrite::handleFunctional(PacketPtr pkt)
+CTWrite::CTWriteStats::CTWriteStats(CTWrite &ctrl) :
+    statistics::Group(&ctrl),
+    ADD_STAT(metaWrites, statistics::units::Count::get(),
+             "Number of metadata writes"),
+    ADD_STAT(metaWriteBytes, statistics::units::Byte::get(),
+             "Number of metadata bytes written")
 {
-    PacketPtr metaPkt = createPkt(
-            AT_START,
-            1,
-            pkt->req->getFlags(),
-            pkt->req->requestorId(),
-            false
-            );
-    memSidePort.sendFunctional(metaPkt);
 }
 
 } // namespace gem5
@@ -1,27 +1,79 @@
 #ifndef __CACHET_CT_WRITE_HH__
 #define __CACHET_CT_WRITE_HH__
 
+#include <list>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
 #include "cachet/base_ctrl.hh"
+#include "cachet/split_counters.hh"
 #include "params/CTWrite.hh"
 
 namespace gem5
 {
 
+/**
+ * Counter tree updater. Up to update_entries updates are in flight at a
+ * time: the MAC, counter and tree nodes of a write are all written at
+ * once, so the updates do not depend on each other.
+ */
 class CTWrite : public BaseCtrl
 {
   private:
+    /** Metadata update of a data write */
+    struct Update
+    {
+        PacketPtr requestPkt;
+        /** Metadata writes not acknowledged yet */
+        unsigned responsesLeft;
+    };
+
+    /** Send the metadata writes of the updates whose hashes are done */
     void processRequestOperation();
     EventFunctionWrapper requestOperation;
+    void sendUpdate(Update *update);
+    void sendMetaPkt(Update *update, PacketPtr pkt);
 
     void processFinishOperation() override;
     bool handleRequest(PacketPtr pkt) override;
     bool handleResponse(PacketPtr pkt) override;
     Tick handleAtomic(PacketPtr pkt) override;
-    void handleFunctional(PacketPtr pkt) override;
+    bool isIdle() const override;
+    bool
+    holdsData(Addr block_addr) const override
+    {
+        return counters.holds(block_addr);
+    }
+
+    void serialize(CheckpointOut &cp) const override;
+    void unserialize(CheckpointIn &cp) override;
+
+    const unsigned updateEntries;
+    std::list<Update> updates;
+    /** Updates waiting for their hashes, by the tick they are done */
+    std::multimap<Tick, Update *> hashQueue;
+    /** Update of every metadata write in flight */
+    std::unordered_map<PacketPtr, Update *> updateOf;
+    /** Updates whose writes are all acknowledged */
+    std::vector<Update *> doneUpdates;
+
+    /**
+     * Single metadata write modelling an atomic data write: its MAC, or
+     * its counter block if the MACs are in ECC.
+     */
+    PacketPtr createMetaPkt(PacketPtr pkt);
+
+    /** Minor counters and their re-encryption, in split-counter mode */
+    SplitCounters counters;
+
+    struct CTWriteStats : public statistics::Group
+    {
+        CTWriteStats(CTWrite &ctrl);
 
-    PacketPtr requestPkt;
-    PacketPtr responsePkt;
-    int responseTimes;
+        statistics::Scalar metaWrites;
+        statistics::Scalar metaWriteBytes;
+    } writeStats;
 
   public:
     CTWrite(const CTWriteParams &p);
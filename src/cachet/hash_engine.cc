@@ -0,0 +1,99 @@
+#include "cachet/hash_engine.hh"
+
+#include <algorithm>
+
+#include "base/intmath.hh"
+#include "base/trace.hh"
+#include "debug/HashEngine.hh"
+#include "sim/stats.hh"
+
+namespace gem5
+{
+
+HashEngine::HashEngine(const HashEngineParams &p) :
+    ClockedObject(p),
+    pipelineDepth(p.pipeline_depth),
+    initiationInterval(p.initiation_interval),
+    laneFree(p.lanes, 0),
+    stats(*this)
+{
+    fatal_if(laneFree.empty(), "%s needs at least one lane", name());
+    fatal_if(pipelineDepth == 0 || initiationInterval == 0,
+            "%s: pipeline depth and initiation interval must be non-zero",
+            name());
+}
+
+Tick
+HashEngine::reserve(unsigned ops)
+{
+    assert(ops > 0);
+
+    Tick now = clockEdge();
+    auto lane = std::min_element(laneFree.begin(), laneFree.end());
+    Tick start = std::max(now, *lane);
+
+    // The hashes of a chain depend on each other, so the lane only takes
+    // the next one once the previous one has left the pipeline
+    Tick ready = start + cyclesToTicks(Cycles(ops * pipelineDepth));
+    *lane = start + cyclesToTicks(
+            Cycles((ops - 1) * pipelineDepth + initiationInterval));
+
+    DPRINTF(HashEngine, "Reserve lane %d for %d ops, start %d ready %d\n",
+            lane - laneFree.begin(), ops, start, ready);
+
+    stats.requests++;
+    stats.hashOps += ops;
+    stats.busyTicks += *lane - start;
+    stats.queueingTicks += start - now;
+    stats.queueingCycles.sample(ticksToCycles(start - now));
+
+    return ready;
+}
+
+Tick
+HashEngine::hashLatency(unsigned ops) const
+{
+    return cyclesToTicks(Cycles(ops * pipelineDepth));
+}
+
+Tick
+HashEngine::batchLatency(uint64_t ops) const
+{
+    if (ops == 0) {
+        return 0;
+    }
+    uint64_t per_lane = divCeil(ops, (uint64_t)laneFree.size());
+    return cyclesToTicks(Cycles(pipelineDepth +
+                (per_lane - 1) * initiationInterval));
+}
+
+HashEngine::HashEngineStats::HashEngineStats(HashEngine &engine) :
+    statistics::Group(&engine),
+    ADD_STAT(requests, statistics::units::Count::get(),
+             "Number of hash chains issued to the engine"),
+    ADD_STAT(hashOps, statistics::units::Count::get(),
+             "Number of hash operations"),
+    ADD_STAT(busyTicks, statistics::units::Tick::get(),
+             "Total ticks the lanes are unable to accept a new operation"),
+    ADD_STAT(queueingTicks, statistics::units::Tick::get(),
+             "Total ticks spent waiting for a free lane"),
+    ADD_STAT(queueingCycles, statistics::units::Cycle::get(),
+             "Cycles spent waiting for a free lane"),
+    ADD_STAT(avgQueueingTicks, statistics::units::Rate<
+                statistics::units::Tick, statistics::units::Count>::get(),
+             "Average ticks spent waiting for a free lane"),
+    ADD_STAT(occupancy, statistics::units::Ratio::get(),
+             "Average fraction of busy lanes")
+{
+    queueingCycles
+        .init(16)
+        .flags(statistics::nozero);
+
+    avgQueueingTicks.precision(2);
+    avgQueueingTicks = queueingTicks / requests;
+
+    occupancy.precision(4);
+    occupancy = busyTicks / simTicks / (unsigned)engine.laneFree.size();
+}
+
+} // namespace gem5
@@ -0,0 +1,69 @@
+#ifndef __CACHET_HASH_ENGINE_HH__
+#define __CACHET_HASH_ENGINE_HH__
+
+#include <vector>
+
+#include "base/statistics.hh"
+#include "params/HashEngine.hh"
+#include "sim/clocked_object.hh"
+
+namespace gem5
+{
+
+/**
+ * Timing model of the hash/MAC units shared by the Cachet controllers.
+ *
+ * The engine has a number of identical lanes. Each lane is pipelined: it
+ * produces a result pipelineDepth cycles after an operation is issued and
+ * accepts a new operation every initiationInterval cycles. Operations are
+ * issued to the lane that frees up first, so callers queue behind each
+ * other when all lanes are busy.
+ */
+class HashEngine : public ClockedObject
+{
+  private:
+    const unsigned pipelineDepth;
+    const unsigned initiationInterval;
+
+    /** Tick at which each lane can accept its next operation */
+    std::vector<Tick> laneFree;
+
+    struct HashEngineStats : public statistics::Group
+    {
+        HashEngineStats(HashEngine &engine);
+
+        statistics::Scalar requests;
+        statistics::Scalar hashOps;
+        statistics::Scalar busyTicks;
+        statistics::Scalar queueingTicks;
+        statistics::Histogram queueingCycles;
+
+        statistics::Formula avgQueueingTicks;
+        statistics::Formula occupancy;
+    } stats;
+
+  public:
+    HashEngine(const HashEngineParams &p);
+
+    /**
+     * Reserve a lane for a chain of dependent hash operations that is
+     * ready to start now.
+     *
+     * @param ops Number of hashes in the chain, each one consuming the
+     *            result of the previous one.
+     * @return Tick at which the result of the last hash is available.
+     */
+    Tick reserve(unsigned ops=1);
+
+    /** Latency of a chain of hashes on an idle engine */
+    Tick hashLatency(unsigned ops=1) const;
+    /**
+     * Latency of a batch of independent hashes on an idle engine, spread
+     * over all the lanes.
+     */
+    Tick batchLatency(uint64_t ops) const;
+};
+
+} // namespace gem5
+
+#endif // __CACHET_HASH_ENGINE_HH__
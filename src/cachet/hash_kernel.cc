@@ -0,0 +1,155 @@
+#include "cachet/hash_kernel.hh"
+
+#include <cstring>
+
+#if defined(__AVX2__) || defined(__SSE4_1__)
+#include <immintrin.h>
+#endif
+
+namespace gem5
+{
+
+namespace
+{
+
+constexpr size_t numLanes = 8;
+constexpr size_t stripeBytes = numLanes * sizeof(uint32_t);
+
+constexpr uint32_t prime1 = 0x9e3779b1U;
+constexpr uint32_t prime2 = 0x85ebca77U;
+constexpr uint64_t prime64 = 0x9e3779b97f4a7c15ULL;
+constexpr unsigned laneRotate = 13;
+
+void
+initLanes(uint32_t *acc, uint64_t seed)
+{
+    for (size_t i = 0; i < numLanes; i++) {
+        acc[i] = ((uint32_t)seed + prime1 * (uint32_t)(i + 1)) ^
+            (uint32_t)(seed >> 32);
+    }
+}
+
+#if defined(__AVX2__)
+
+void
+hashStripes(uint32_t *acc, const uint8_t *data, size_t stripes)
+{
+    const __m256i p1 = _mm256_set1_epi32(prime1);
+    const __m256i p2 = _mm256_set1_epi32(prime2);
+    __m256i lanes = _mm256_loadu_si256((const __m256i *)acc);
+
+    for (size_t i = 0; i < stripes; i++) {
+        __m256i words = _mm256_loadu_si256(
+                (const __m256i *)(data + i * stripeBytes));
+        lanes = _mm256_add_epi32(lanes, _mm256_mullo_epi32(words, p2));
+        lanes = _mm256_or_si256(_mm256_slli_epi32(lanes, laneRotate),
+                _mm256_srli_epi32(lanes, 32 - laneRotate));
+        lanes = _mm256_mullo_epi32(lanes, p1);
+    }
+
+    _mm256_storeu_si256((__m256i *)acc, lanes);
+}
+
+#elif defined(__SSE4_1__)
+
+void
+hashStripes(uint32_t *acc, const uint8_t *data, size_t stripes)
+{
+    const __m128i p1 = _mm_set1_epi32(prime1);
+    const __m128i p2 = _mm_set1_epi32(prime2);
+    __m128i lo = _mm_loadu_si128((const __m128i *)acc);
+    __m128i hi = _mm_loadu_si128((const __m128i *)(acc + 4));
+
+    for (size_t i = 0; i < stripes; i++) {
+        const uint8_t *stripe = data + i * stripeBytes;
+        __m128i words_lo = _mm_loadu_si128((const __m128i *)stripe);
+        __m128i words_hi = _mm_loadu_si128((const __m128i *)(stripe + 16));
+
+        lo = _mm_add_epi32(lo, _mm_mullo_epi32(words_lo, p2));
+        hi = _mm_add_epi32(hi, _mm_mullo_epi32(words_hi, p2));
+        lo = _mm_or_si128(_mm_slli_epi32(lo, laneRotate),
+                _mm_srli_epi32(lo, 32 - laneRotate));
+        hi = _mm_or_si128(_mm_slli_epi32(hi, laneRotate),
+                _mm_srli_epi32(hi, 32 - laneRotate));
+        lo = _mm_mullo_epi32(lo, p1);
+        hi = _mm_mullo_epi32(hi, p1);
+    }
+
+    _mm_storeu_si128((__m128i *)acc, lo);
+    _mm_storeu_si128((__m128i *)(acc + 4), hi);
+}
+
+#else
+
+void
+hashStripes(uint32_t *acc, const uint8_t *data, size_t stripes)
+{
+    for (size_t i = 0; i < stripes; i++) {
+        for (size_t lane = 0; lane < numLanes; lane++) {
+            uint32_t word;
+            std::memcpy(&word, data + i * stripeBytes + lane * 4, 4);
+            uint32_t v = acc[lane] + word * prime2;
+            v = (v << laneRotate) | (v >> (32 - laneRotate));
+            acc[lane] = v * prime1;
+        }
+    }
+}
+
+#endif
+
+} // anonymous namespace
+
+uint64_t
+hashBytes(const uint8_t *data, size_t len, uint64_t seed)
+{
+    uint32_t acc[numLanes];
+    initLanes(acc, seed);
+
+    size_t stripes = len / stripeBytes;
+    hashStripes(acc, data, stripes);
+
+    // The tail is zero padded to a full stripe
+    size_t tail = len - stripes * stripeBytes;
+    if (tail) {
+        uint8_t last[stripeBytes] = {};
+        std::memcpy(last, data + stripes * stripeBytes, tail);
+        hashStripes(acc, last, 1);
+    }
+
+    uint64_t h = seed ^ (len * prime64);
+    for (size_t i = 0; i < numLanes; i++) {
+        h ^= acc[i];
+        h *= prime64;
+        h ^= h >> 29;
+    }
+
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+uint64_t
+macBytes(const uint8_t *data, size_t len, uint64_t addr, uint64_t counter,
+         uint64_t key)
+{
+    uint64_t seed = key ^ hashBytes((const uint8_t *)&addr, sizeof(addr),
+            counter);
+    return hashBytes(data, len, seed);
+}
+
+const char *
+hashKernelName()
+{
+#if defined(__AVX2__)
+    return "avx2";
+#elif defined(__SSE4_1__)
+    return "sse4.1";
+#else
+    return "scalar";
+#endif
+}
+
+} // namespace gem5
@@ -0,0 +1,36 @@
+#ifndef __CACHET_HASH_KERNEL_HH__
+#define __CACHET_HASH_KERNEL_HH__
+
+#include <cstddef>
+#include <cstdint>
+
+namespace gem5
+{
+
+/**
+ * Keyed 64-bit hash used by the functional integrity checks.
+ *
+ * The input is consumed in 32-byte stripes by eight independent 32-bit
+ * lanes, which map onto one AVX2 or two SSE4.1 registers when the host
+ * build enables them, and fall back to a plain loop otherwise. All the
+ * variants produce the same value, so checkpoints taken with one can be
+ * restored with another. The words are read in host byte order.
+ *
+ * This is a fast simulation stand-in for the MAC and tree hashes of the
+ * hardware, it offers no cryptographic strength.
+ */
+uint64_t hashBytes(const uint8_t *data, size_t len, uint64_t seed);
+
+/**
+ * MAC of a data block. The address and the write counter are folded
+ * into the key, which binds the ciphertext to its location and version.
+ */
+uint64_t macBytes(const uint8_t *data, size_t len, uint64_t addr,
+                  uint64_t counter, uint64_t key);
+
+/** Name of the hash kernel variant compiled in */
+const char *hashKernelName();
+
+} // namespace gem5
+
+#endif // __CACHET_HASH_KERNEL_HH__
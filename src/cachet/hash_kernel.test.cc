@@ -0,0 +1,130 @@
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <vector>
+
+#include "cachet/hash_kernel.hh"
+
+using namespace gem5;
+
+namespace
+{
+
+/** Plain loop version of hashBytes, the reference of every variant */
+uint64_t
+referenceHash(const uint8_t *data, size_t len, uint64_t seed)
+{
+    const uint32_t prime1 = 0x9e3779b1U;
+    const uint32_t prime2 = 0x85ebca77U;
+    const uint64_t prime64 = 0x9e3779b97f4a7c15ULL;
+
+    uint32_t acc[8];
+    for (size_t i = 0; i < 8; i++) {
+        acc[i] = ((uint32_t)seed + prime1 * (uint32_t)(i + 1)) ^
+            (uint32_t)(seed >> 32);
+    }
+
+    // The tail is zero padded to a full stripe
+    std::vector<uint8_t> padded(data, data + len);
+    padded.resize((len + 31) / 32 * 32, 0);
+    for (size_t stripe = 0; stripe < padded.size(); stripe += 32) {
+        for (size_t lane = 0; lane < 8; lane++) {
+            uint32_t word;
+            std::memcpy(&word, padded.data() + stripe + lane * 4, 4);
+            uint32_t v = acc[lane] + word * prime2;
+            v = (v << 13) | (v >> 19);
+            acc[lane] = v * prime1;
+        }
+    }
+
+    uint64_t h = seed ^ (len * prime64);
+    for (size_t i = 0; i < 8; i++) {
+        h ^= acc[i];
+        h *= prime64;
+        h ^= h >> 29;
+    }
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+/** Fixed input with no repeating pattern */
+std::vector<uint8_t>
+testVector(size_t len)
+{
+    std::vector<uint8_t> data(len);
+    uint32_t x = 0x12345678;
+    for (auto &byte : data) {
+        x = x * 1103515245 + 12345;
+        byte = x >> 24;
+    }
+    return data;
+}
+
+} // anonymous namespace
+
+/*
+ * Whichever variant is compiled in must give the value of the plain
+ * loop, on whole stripes and on zero padded tails alike.
+ */
+TEST(HashKernelTest, MatchesReference)
+{
+    const size_t lengths[] = {0, 1, 4, 31, 32, 33, 63, 64, 72, 100, 4096};
+    const uint64_t seeds[] = {0, 1, 0x5ec0de5ec0de, ~0ULL};
+    for (size_t len : lengths) {
+        auto data = testVector(len);
+        for (uint64_t seed : seeds) {
+            EXPECT_EQ(referenceHash(data.data(), len, seed),
+                      hashBytes(data.data(), len, seed))
+                << hashKernelName() << " kernel, " << len << " bytes, seed "
+                << seed;
+        }
+    }
+}
+
+/* The length is hashed too, so zero padding does not alias */
+TEST(HashKernelTest, PaddingDoesNotAlias)
+{
+    std::vector<uint8_t> data(64, 0);
+    EXPECT_NE(hashBytes(data.data(), 33, 0), hashBytes(data.data(), 64, 0));
+    EXPECT_NE(hashBytes(data.data(), 0, 0), hashBytes(data.data(), 32, 0));
+}
+
+TEST(HashKernelTest, SeedChangesHash)
+{
+    auto data = testVector(64);
+    EXPECT_NE(hashBytes(data.data(), 64, 1), hashBytes(data.data(), 64, 2));
+}
+
+/*
+ * A MAC verifies against the data it was computed over, and stops
+ * verifying once the data, the address or the counter changes.
+ */
+TEST(HashKernelTest, MacRoundTrip)
+{
+    const uint64_t key = 0x5ec0de5ec0de;
+    const uint64_t addr = 0x1040;
+    auto data = testVector(64);
+
+    uint64_t mac = macBytes(data.data(), 64, addr, 0, key);
+    EXPECT_EQ(mac, macBytes(data.data(), 64, addr, 0, key));
+
+    // Flipped bit of the ciphertext
+    data[17] ^= 0x4;
+    EXPECT_NE(mac, macBytes(data.data(), 64, addr, 0, key));
+    data[17] ^= 0x4;
+
+    // Same data at another address or under another key
+    EXPECT_NE(mac, macBytes(data.data(), 64, addr + 64, 0, key));
+    EXPECT_NE(mac, macBytes(data.data(), 64, addr, 0, key + 1));
+
+    // An update bumps the counter: the new MAC verifies, and the old one
+    // no longer does, even over the old data
+    uint64_t new_mac = macBytes(data.data(), 64, addr, 1, key);
+    EXPECT_NE(mac, new_mac);
+    EXPECT_EQ(new_mac, macBytes(data.data(), 64, addr, 1, key));
+    EXPECT_NE(mac, macBytes(data.data(), 64, addr, 1, key));
+}
@@ -0,0 +1,353 @@
+#include "cachet/integrity_checker.hh"
+
+#include <algorithm>
+#include <cstring>
+
+#include "base/cprintf.hh"
+#include "base/intmath.hh"
+#include "base/trace.hh"
+#include "cachet/hash_kernel.hh"
+#include "debug/IntegrityChecker.hh"
+#include "sim/sim_exit.hh"
+
+namespace gem5
+{
+
+IntegrityChecker::IntegrityChecker(BaseCtrl &_ctrl,
+                                   BaseCtrl::MemSidePort &_port,
+                                   uint64_t _key, bool halt_on_violation) :
+    ctrl(_ctrl),
+    layout(_ctrl.layout),
+    port(_port),
+    key(_key),
+    haltOnViolation(halt_on_violation),
+    rootHash(0),
+    zeroBlock(_ctrl.layout->getBlockSize(), 0),
+    stats(_ctrl)
+{
+    const unsigned levels = layout->numLevels();
+    nodeContent.resize(std::max(layout->arity(0),
+                levels > 1 ? layout->arity(1) : 0));
+
+    // An untouched node holds untouched children, so its hash only
+    // depends on its level
+    defaultHashes.resize(levels);
+    for (unsigned level = 0; level < levels; level++) {
+        std::fill_n(nodeContent.begin(), layout->arity(level),
+                level == 0 ? 0 : defaultHashes[level - 1]);
+        defaultHashes[level] = hashBytes(
+                (const uint8_t *)nodeContent.data(),
+                layout->arity(level) * sizeof(uint64_t), key ^ level);
+    }
+    rootHash = defaultHashes.back();
+
+    DPRINTF(IntegrityChecker, "Using the %s hash kernel\n",
+            hashKernelName());
+}
+
+uint64_t
+IntegrityChecker::blockMac(Addr block, uint64_t counter,
+                           const uint8_t *data)
+{
+    const unsigned block_size = layout->getBlockSize();
+    stats.hashedBytes += block_size;
+    return macBytes(data, block_size, block, counter, key);
+}
+
+uint64_t
+IntegrityChecker::storedCounter(Addr block) const
+{
+    auto it = counters.find(block);
+    return it == counters.end() ? 0 : it->second;
+}
+
+uint64_t
+IntegrityChecker::storedMac(Addr block)
+{
+    auto it = macs.find(block);
+    if (it != macs.end()) {
+        return it->second;
+    }
+    return blockMac(block, 0, zeroBlock.data());
+}
+
+uint64_t
+IntegrityChecker::storedHash(Addr node, unsigned level) const
+{
+    auto it = nodeHashes.find(node);
+    return it == nodeHashes.end() ? defaultHashes[level] : it->second;
+}
+
+uint64_t
+IntegrityChecker::hashNode(Addr node, unsigned level)
+{
+    const unsigned arity = layout->arity(level);
+    for (unsigned i = 0; i < arity; i++) {
+        // Children past the end of the level keep their untouched value
+        Addr child = layout->childAddr(node, i);
+        nodeContent[i] = level == 0 ? storedCounter(child) :
+            storedHash(child, level - 1);
+    }
+    stats.hashedBytes += arity * sizeof(uint64_t);
+    return hashBytes((const uint8_t *)nodeContent.data(),
+            arity * sizeof(uint64_t), key ^ level);
+}
+
+void
+IntegrityChecker::readBlock(Addr block, uint8_t *data)
+{
+    PacketPtr pkt = ctrl.createPkt(
+            block,
+            layout->getBlockSize(),
+            0,
+            Request::funcRequestorId,
+            true
+            );
+    port.sendFunctional(pkt);
+    std::memcpy(data, pkt->getConstPtr<uint8_t>(), layout->getBlockSize());
+    ctrl.destroyPkt(pkt);
+}
+
+void
+IntegrityChecker::violation(Addr addr, const char *what)
+{
+    stats.violations++;
+    std::string msg = csprintf("Integrity violation: %s of %#x does not "
+            "match", what, addr);
+    if (haltOnViolation) {
+        exitSimLoop(msg);
+    } else {
+        warn("%s: %s", ctrl.name(), msg);
+    }
+}
+
+void
+IntegrityChecker::checkBlock(Addr block, const uint8_t *data)
+{
+    DPRINTF(IntegrityChecker, "Check block %#x\n", block);
+    stats.checkedBlocks++;
+
+    if (blockMac(block, storedCounter(block), data) != storedMac(block)) {
+        violation(block, "MAC");
+    }
+
+    // Walk up from the counter block, each node being checked against
+    // the value held by its parent and the root against the register
+    Addr node = layout->counterAddr(block);
+    for (unsigned level = 0; ; level++) {
+        uint64_t hash = hashNode(node, level);
+        if (level + 1 == layout->numLevels()) {
+            if (hash != rootHash) {
+                violation(node, "root hash");
+            }
+            break;
+        }
+        if (hash != storedHash(node, level)) {
+            violation(node, level == 0 ? "counter hash" : "tree node hash");
+        }
+        node = layout->parentAddr(node);
+    }
+}
+
+void
+IntegrityChecker::updateBlock(Addr block, const uint8_t *data)
+{
+    DPRINTF(IntegrityChecker, "Update block %#x\n", block);
+    stats.updatedBlocks++;
+
+    uint64_t counter = ++counters[block];
+    macs[block] = blockMac(block, counter, data);
+
+    Addr node = layout->counterAddr(block);
+    for (unsigned level = 0; ; level++) {
+        uint64_t hash = hashNode(node, level);
+        if (level + 1 == layout->numLevels()) {
+            rootHash = hash;
+            break;
+        }
+        nodeHashes[node] = hash;
+        node = layout->parentAddr(node);
+    }
+}
+
+void
+IntegrityChecker::verify(PacketPtr pkt)
+{
+    const unsigned block_size = layout->getBlockSize();
+    std::vector<uint8_t> data(block_size);
+    const Addr start = pkt->getAddr();
+    const Addr end = start + pkt->getSize();
+
+    for (Addr block = roundDown(start, (Addr)block_size); block < end;
+            block += block_size) {
+        if (block >= start && block + block_size <= end) {
+            checkBlock(block, pkt->getConstPtr<uint8_t>() + (block - start));
+        } else {
+            // The access only covers part of the block, the MAC is over
+            // all of it
+            readBlock(block, data.data());
+            checkBlock(block, data.data());
+        }
+    }
+}
+
+void
+IntegrityChecker::update(PacketPtr pkt)
+{
+    update(pkt, pkt->getAddr(), pkt->getAddr() + pkt->getSize());
+}
+
+void
+IntegrityChecker::update(PacketPtr pkt, Addr start, Addr end)
+{
+    if (!pkt->hasData()) {
+        return;
+    }
+
+    const unsigned block_size = layout->getBlockSize();
+    std::vector<uint8_t> data(block_size);
+    const Addr pkt_start = pkt->getAddr();
+    start = std::max(start, pkt_start);
+    end = std::min(end, pkt_start + pkt->getSize());
+
+    for (Addr block = roundDown(start, (Addr)block_size); block < end;
+            block += block_size) {
+        Addr lo = std::max(block, start);
+        Addr hi = std::min(block + block_size, end);
+        if (hi - lo < block_size) {
+            // Merge the bytes written into the current contents. A
+            // partial write racing an older write of the same block still
+            // in the crossbar would miss it, only uncached accesses write
+            // partial blocks.
+            readBlock(block, data.data());
+        }
+        std::memcpy(data.data() + (lo - block),
+                pkt->getConstPtr<uint8_t>() + (lo - pkt_start), hi - lo);
+        updateBlock(block, data.data());
+    }
+}
+
+void
+IntegrityChecker::injectFault(Addr addr)
+{
+    if (!layout->inChannel(addr)) {
+        return;
+    }
+
+    const unsigned block_size = layout->getBlockSize();
+    if (layout->isData(addr)) {
+        Addr block = roundDown(addr, (Addr)block_size);
+        PacketPtr pkt = ctrl.createPkt(
+                block,
+                block_size,
+                0,
+                Request::funcRequestorId,
+                false
+                );
+        readBlock(block, pkt->getPtr<uint8_t>());
+        pkt->getPtr<uint8_t>()[addr - block] ^= 1;
+        port.sendFunctional(pkt);
+        ctrl.destroyPkt(pkt);
+        inform("%s: flipped a bit of the data at %#x", ctrl.name(), addr);
+        return;
+    }
+
+    fatal_if(layout->isMac(addr), "%s: MAC faults are not supported",
+            ctrl.name());
+    fatal_if(layout->isRoot(addr), "%s: the root is kept on chip and "
+            "cannot be corrupted", ctrl.name());
+
+    Addr node = roundDown(addr, (Addr)block_size);
+    unsigned level = layout->levelOf(node);
+    Addr child = layout->childAddr(node, 0);
+    if (level == 0) {
+        counters[child] = storedCounter(child) ^ 1;
+    } else {
+        nodeHashes[child] = storedHash(child, level - 1) ^ 1;
+    }
+    inform("%s: corrupted the stored %s at %#x", ctrl.name(),
+            level == 0 ? "counter block" : "tree node", node);
+}
+
+void
+IntegrityChecker::serialize(CheckpointOut &cp) const
+{
+    std::vector<Addr> counter_blocks;
+    std::vector<uint64_t> counter_values;
+    for (const auto &counter : counters) {
+        counter_blocks.push_back(counter.first);
+        counter_values.push_back(counter.second);
+    }
+    std::vector<Addr> mac_blocks;
+    std::vector<uint64_t> mac_values;
+    for (const auto &mac : macs) {
+        mac_blocks.push_back(mac.first);
+        mac_values.push_back(mac.second);
+    }
+    std::vector<Addr> hash_nodes;
+    std::vector<uint64_t> hash_values;
+    for (const auto &hash : nodeHashes) {
+        hash_nodes.push_back(hash.first);
+        hash_values.push_back(hash.second);
+    }
+
+    SERIALIZE_CONTAINER(counter_blocks);
+    SERIALIZE_CONTAINER(counter_values);
+    SERIALIZE_CONTAINER(mac_blocks);
+    SERIALIZE_CONTAINER(mac_values);
+    SERIALIZE_CONTAINER(hash_nodes);
+    SERIALIZE_CONTAINER(hash_values);
+    SERIALIZE_SCALAR(rootHash);
+}
+
+void
+IntegrityChecker::unserialize(CheckpointIn &cp)
+{
+    std::vector<Addr> counter_blocks;
+    std::vector<uint64_t> counter_values;
+    std::vector<Addr> mac_blocks;
+    std::vector<uint64_t> mac_values;
+    std::vector<Addr> hash_nodes;
+    std::vector<uint64_t> hash_values;
+
+    UNSERIALIZE_CONTAINER(counter_blocks);
+    UNSERIALIZE_CONTAINER(counter_values);
+    UNSERIALIZE_CONTAINER(mac_blocks);
+    UNSERIALIZE_CONTAINER(mac_values);
+    UNSERIALIZE_CONTAINER(hash_nodes);
+    UNSERIALIZE_CONTAINER(hash_values);
+    UNSERIALIZE_SCALAR(rootHash);
+    fatal_if(counter_blocks.size() != counter_values.size() ||
+            mac_blocks.size() != mac_values.size() ||
+            hash_nodes.size() != hash_values.size(),
+            "Corrupt integrity checker checkpoint");
+
+    counters.clear();
+    for (size_t i = 0; i < counter_blocks.size(); i++) {
+        counters[counter_blocks[i]] = counter_values[i];
+    }
+    macs.clear();
+    for (size_t i = 0; i < mac_blocks.size(); i++) {
+        macs[mac_blocks[i]] = mac_values[i];
+    }
+    nodeHashes.clear();
+    for (size_t i = 0; i < hash_nodes.size(); i++) {
+        nodeHashes[hash_nodes[i]] = hash_values[i];
+    }
+}
+
+IntegrityChecker::IntegrityCheckerStats::IntegrityCheckerStats(
+        BaseCtrl &ctrl) :
+    statistics::Group(&ctrl, "integrityChecker"),
+    ADD_STAT(checkedBlocks, statistics::units::Count::get(),
+             "Number of data blocks checked on a read"),
+    ADD_STAT(updatedBlocks, statistics::units::Count::get(),
+             "Number of data blocks whose metadata was recomputed"),
+    ADD_STAT(hashedBytes, statistics::units::Byte::get(),
+             "Number of bytes run through the hash kernel"),
+    ADD_STAT(violations, statistics::units::Count::get(),
+             "Number of MAC or hash mismatches detected")
+{
+}
+
+} // namespace gem5
@@ -0,0 +1,102 @@
+#ifndef __CACHET_INTEGRITY_CHECKER_HH__
+#define __CACHET_INTEGRITY_CHECKER_HH__
+
+#include <unordered_map>
+#include <vector>
+
+#include "cachet/base_ctrl.hh"
+#include "sim/serialize.hh"
+
+namespace gem5
+{
+
+/**
+ * Functional integrity checking of the data crossing SecCtrl.
+ *
+ * The timing controllers only move empty metadata packets around. This
+ * class computes the values the hardware would store instead: a write
+ * counter and a MAC over the ciphertext, address and counter of every
+ * data block, and the hash of every counter block and tree node, checked
+ * up to the root register kept on chip. Every data block read is checked
+ * against them, so a corruption of the memory contents or of the stored
+ * metadata is caught as soon as the block is read again.
+ *
+ * The metadata values live here rather than in simulated memory. Blocks
+ * and nodes never written keep the values of an all-zero memory.
+ */
+class IntegrityChecker : public Serializable
+{
+  private:
+    BaseCtrl &ctrl;
+    IntegrityLayout *layout;
+    /** Port reaching the data, used to fill partial blocks */
+    BaseCtrl::MemSidePort &port;
+
+    const uint64_t key;
+    /** Stop the simulation on a violation instead of only counting it */
+    const bool haltOnViolation;
+
+    /** Write counter of every data block written, absent means 0 */
+    std::unordered_map<Addr, uint64_t> counters;
+    /** MAC of every data block written */
+    std::unordered_map<Addr, uint64_t> macs;
+    /** Hash of every counter block and tree node below the root */
+    std::unordered_map<Addr, uint64_t> nodeHashes;
+    /** Hash of the root node, kept on chip */
+    uint64_t rootHash;
+
+    /** Hash of a node of each level that was never written */
+    std::vector<uint64_t> defaultHashes;
+    /** Contents of a block never written */
+    std::vector<uint8_t> zeroBlock;
+    /** Scratch buffer holding the child values of the node being hashed */
+    std::vector<uint64_t> nodeContent;
+
+    uint64_t blockMac(Addr block, uint64_t counter, const uint8_t *data);
+    uint64_t storedCounter(Addr block) const;
+    uint64_t storedMac(Addr block);
+    uint64_t storedHash(Addr node, unsigned level) const;
+    /** Hash of a node computed from the values stored for its children */
+    uint64_t hashNode(Addr node, unsigned level);
+
+    void readBlock(Addr block, uint8_t *data);
+    void checkBlock(Addr block, const uint8_t *data);
+    void updateBlock(Addr block, const uint8_t *data);
+    void violation(Addr addr, const char *what);
+
+    struct IntegrityCheckerStats : public statistics::Group
+    {
+        IntegrityCheckerStats(BaseCtrl &ctrl);
+
+        statistics::Scalar checkedBlocks;
+        statistics::Scalar updatedBlocks;
+        statistics::Scalar hashedBytes;
+        statistics::Scalar violations;
+    } stats;
+
+  public:
+    IntegrityChecker(BaseCtrl &ctrl, BaseCtrl::MemSidePort &port,
+                     uint64_t key, bool halt_on_violation);
+
+    /** Check the blocks returned by a read response */
+    void verify(PacketPtr pkt);
+    /** Recompute the metadata of the blocks a write is about to change */
+    void update(PacketPtr pkt);
+    /** Same, for the bytes of the write within [start, end) only */
+    void update(PacketPtr pkt, Addr start, Addr end);
+
+    /**
+     * Tamper with the memory behind the back of the controller. A data
+     * address gets a bit of its memory contents flipped, a counter or tree
+     * node address gets its stored value corrupted. Addresses outside the
+     * channel are ignored.
+     */
+    void injectFault(Addr addr);
+
+    void serialize(CheckpointOut &cp) const override;
+    void unserialize(CheckpointIn &cp) override;
+};
+
+} // namespace gem5
+
+#endif // __CACHET_INTEGRITY_CHECKER_HH__
@@ -0,0 +1,180 @@
+#include "cachet/integrity_layout.hh"
+
+#include <algorithm>
+
+#include "base/intmath.hh"
+#include "base/logging.hh"
+#include "base/trace.hh"
+#include "debug/IntegrityLayout.hh"
+
+namespace gem5
+{
+
+IntegrityLayout::IntegrityLayout(const IntegrityLayoutParams &p) :
+    SimObject(p),
+    protectedSize(p.protected_size),
+    channelRange(p.channel_range),
+    blockSize(p.block_size),
+    macSize(p.mac_size),
+    macInEcc(p.mac_in_ecc),
+    counterArity(p.counter_arity),
+    treeArity(p.tree_arity),
+    splitCounters(p.split_counters),
+    majorCounterBits(p.major_counter_bits),
+    minorCounterBits(p.minor_counter_bits),
+    blockShift(floorLog2(p.block_size)),
+    counterShift(floorLog2(p.counter_arity)),
+    treeShift(floorLog2(p.tree_arity)),
+    shadowEntries(p.shadow_entries),
+    shadowRegionSize(roundUp((Addr)p.shadow_entries * shadowEntrySize,
+                             (Addr)p.block_size))
+{
+    fatal_if(!isPowerOf2(blockSize), "%s: block size must be a power of 2",
+            name());
+    fatal_if(!isPowerOf2(macSize) || macSize > blockSize,
+            "%s: MAC size must be a power of 2 up to the block size",
+            name());
+    fatal_if(!isPowerOf2(counterArity), "%s: counter arity must be a "
+            "power of 2", name());
+    fatal_if(!isPowerOf2(treeArity) || treeArity < 2, "%s: tree arity "
+            "must be a power of 2 greater than 1", name());
+    fatal_if(splitCounters && (minorCounterBits == 0 ||
+            minorCounterBits >= 32 || majorCounterBits > 64),
+            "%s: minor counters must be 1 to 31 bits and major counters "
+            "at most 64 bits", name());
+    fatal_if(splitCounters && majorCounterBits +
+            counterArity * minorCounterBits > blockSize * 8,
+            "%s: %d minor counters of %d bits and a %d bit major counter "
+            "do not fit a %d byte counter block", name(), counterArity,
+            minorCounterBits, majorCounterBits, blockSize);
+    fatal_if(protectedSize % blockSize != 0, "%s: protected size must be "
+            "a multiple of the block size", name());
+    // The MAC region is linear, so the MACs of a row of data are
+    // contiguous and the DRAM can put them in the tail of that row, as
+    // long as they fill whole MAC blocks
+    fatal_if(p.row_data_bytes && (macInEcc ||
+            p.row_data_bytes % (blockSize / macSize * blockSize) != 0),
+            "%s: the MACs of %d bytes of data do not fill whole blocks "
+            "of a MAC region", name(), p.row_data_bytes);
+
+    fatal_if(channelRange.interleaved() &&
+            channelRange.granularity() < blockSize,
+            "%s: channel interleaving must not split a block", name());
+    fatal_if(channelRange.interleaved() &&
+            protectedSize % (channelRange.granularity() *
+                channelRange.stripes()) != 0,
+            "%s: protected size must cover whole interleaving stripes",
+            name());
+
+    // Each channel protects its share of the data, the rest of the
+    // geometry is channel-local
+    Addr local_size = protectedSize / channelRange.stripes();
+    Addr blocks = local_size >> blockShift;
+
+    macBase = local_size;
+    macRegionSize = macInEcc ? 0 : roundUp(blocks * macSize, blockSize);
+
+    // Counters, then every tree layer until a single node is left
+    Addr nodes = divCeil(blocks, (Addr)counterArity);
+    Addr base = macBase + macRegionSize;
+    while (true) {
+        levelBases.push_back(base);
+        levelSizes.push_back(nodes << blockShift);
+        DPRINTF(IntegrityLayout, "Level %d: %#x, %d nodes\n",
+                levelBases.size() - 1, base, nodes);
+        if (nodes == 1 && levelBases.size() > 1) {
+            break;
+        }
+        base += nodes << blockShift;
+        nodes = divCeil(nodes, (Addr)treeArity);
+    }
+    // There is always a root above the counters
+    assert(levelBases.size() >= 2);
+}
+
+Addr
+IntegrityLayout::shadowAddr(unsigned entry) const
+{
+    assert(entry < shadowEntries);
+    return toGlobal(localMetaEnd() + entry * shadowEntrySize);
+}
+
+unsigned
+IntegrityLayout::levelOf(Addr addr) const
+{
+    Addr local = toLocal(addr);
+    assert(local >= levelBases.front() && local < localMetaEnd());
+    auto it = std::upper_bound(levelBases.begin(), levelBases.end(), local);
+    return it - levelBases.begin() - 1;
+}
+
+Addr
+IntegrityLayout::macAddr(Addr data_addr) const
+{
+    assert(isData(data_addr) && !macInEcc);
+    return toGlobal(macBase + (toLocal(data_addr) >> blockShift) * macSize);
+}
+
+Addr
+IntegrityLayout::counterAddr(Addr data_addr) const
+{
+    assert(isData(data_addr));
+    Addr index = toLocal(data_addr) >> blockShift >> counterShift;
+    return toGlobal(levelBases[0] + (index << blockShift));
+}
+
+Addr
+IntegrityLayout::parentAddr(Addr addr) const
+{
+    unsigned level = levelOf(addr);
+    assert(level + 1 < numLevels());
+    Addr index = (toLocal(addr) - levelBases[level]) >> blockShift >>
+        treeShift;
+    return toGlobal(levelBases[level + 1] + (index << blockShift));
+}
+
+Addr
+IntegrityLayout::childAddr(Addr addr, unsigned i) const
+{
+    unsigned level = levelOf(addr);
+    assert(i < arity(level));
+    Addr index = (toLocal(addr) - levelBases[level]) >> blockShift;
+
+    if (level == 0) {
+        Addr child = ((index << counterShift) + i) << blockShift;
+        return child < protectedSize / channelRange.stripes() ?
+            toGlobal(child) : MaxAddr;
+    }
+
+    Addr child = ((index << treeShift) + i) << blockShift;
+    return child < levelSizes[level - 1] ?
+        toGlobal(levelBases[level - 1] + child) : MaxAddr;
+}
+
+uint64_t
+IntegrityLayout::counterField(const uint8_t *block, unsigned field) const
+{
+    assert(field <= counterArity);
+    const unsigned offset = fieldOffset(field);
+    uint64_t value = 0;
+    for (unsigned bit = 0; bit < fieldWidth(field); bit++) {
+        unsigned pos = offset + bit;
+        value |= (uint64_t)((block[pos / 8] >> (pos % 8)) & 1) << bit;
+    }
+    return value;
+}
+
+void
+IntegrityLayout::setCounterField(uint8_t *block, unsigned field,
+                                 uint64_t value) const
+{
+    assert(field <= counterArity);
+    const unsigned offset = fieldOffset(field);
+    for (unsigned bit = 0; bit < fieldWidth(field); bit++) {
+        unsigned pos = offset + bit;
+        block[pos / 8] &= ~(1 << (pos % 8));
+        block[pos / 8] |= ((value >> bit) & 1) << (pos % 8);
+    }
+}
+
+} // namespace gem5
@@ -0,0 +1,199 @@
+#ifndef __CACHET_INTEGRITY_LAYOUT_HH__
+#define __CACHET_INTEGRITY_LAYOUT_HH__
+
+#include <vector>
+
+#include "base/addr_range.hh"
+#include "base/types.hh"
+#include "params/IntegrityLayout.hh"
+#include "sim/sim_object.hh"
+
+namespace gem5
+{
+
+/**
+ * Geometry of the integrity metadata protecting the data region.
+ *
+ * The metadata starts right after the protected data and is laid out as
+ * the MAC region, the counter region, then one region per Merkle tree
+ * layer up to a single root node. When the MACs travel with the data,
+ * there is no MAC region and the counters come first. Level 0 is the
+ * counter region, level 1 is the leaf layer of the tree and the last
+ * level is the root. The base and size of every level are computed once
+ * at construction so that the controllers only do a table lookup per
+ * packet.
+ *
+ * With several memory channels every channel has its own tree, covering
+ * only the data interleaved to it. The geometry is then computed in the
+ * channel-local address space, with the interleaving bits removed, and
+ * the metadata addresses are interleaved back into the channel so that
+ * each tree and its root stay in the channel they protect.
+ *
+ * In the persistent modes, a shadow table recording the tree nodes dirty
+ * in the meta cache follows the root, one address per entry.
+ *
+ * The MAC of a data block is at a fixed stride in the MAC region, so the
+ * MACs of a DRAM row of data are contiguous. The DRAM may then place them
+ * in the tail of that row, see DRAMInterface::placeInRow, and the layout
+ * only checks that they fill whole blocks.
+ */
+class IntegrityLayout : public SimObject
+{
+  private:
+    const Addr protectedSize;
+    /** Interleaved range of the channel this tree protects */
+    const AddrRange channelRange;
+    const unsigned blockSize;
+    const unsigned macSize;
+    const bool macInEcc;
+    const unsigned counterArity;
+    const unsigned treeArity;
+
+    const bool splitCounters;
+    const unsigned majorCounterBits;
+    const unsigned minorCounterBits;
+
+    const unsigned blockShift;
+    const unsigned counterShift;
+    const unsigned treeShift;
+
+    /** Channel-local MAC region */
+    Addr macBase;
+    Addr macRegionSize;
+
+    /** Channel-local base of every level, from the counters to the root */
+    std::vector<Addr> levelBases;
+    /** Size in bytes of every level */
+    std::vector<Addr> levelSizes;
+
+    const unsigned shadowEntries;
+    const Addr shadowRegionSize;
+
+    /** First bit and width of a field of a split counter block */
+    unsigned
+    fieldOffset(unsigned field) const
+    {
+        return field == 0 ? 0 :
+            majorCounterBits + (field - 1) * minorCounterBits;
+    }
+    unsigned
+    fieldWidth(unsigned field) const
+    {
+        return field == 0 ? majorCounterBits : minorCounterBits;
+    }
+
+    Addr
+    localMetaEnd() const
+    {
+        return levelBases.back() + levelSizes.back();
+    }
+
+  public:
+    IntegrityLayout(const IntegrityLayoutParams &p);
+
+    unsigned getBlockSize() const { return blockSize; }
+    unsigned getMacSize() const { return macSize; }
+    unsigned getCounterArity() const { return counterArity; }
+    /** Whether the MACs are fetched with the data instead of separately */
+    bool hasMacInEcc() const { return macInEcc; }
+
+    /** Whether the counter blocks hold split major/minor counters */
+    bool hasSplitCounters() const { return splitCounters; }
+    unsigned getMajorCounterBits() const { return majorCounterBits; }
+    unsigned getMinorCounterBits() const { return minorCounterBits; }
+    /**
+     * Field of a split counter block, packed from bit 0 of the block:
+     * field 0 is the major counter and field i + 1 the minor counter of
+     * the i-th child.
+     */
+    uint64_t counterField(const uint8_t *block, unsigned field) const;
+    void setCounterField(uint8_t *block, unsigned field,
+                         uint64_t value) const;
+
+    /** Strip the channel interleaving bits off an address */
+    Addr
+    toLocal(Addr addr) const
+    {
+        return channelRange.removeIntlvBits(addr);
+    }
+    /** Interleave a channel-local address back into the channel */
+    Addr
+    toGlobal(Addr addr) const
+    {
+        return channelRange.addIntlvBits(addr);
+    }
+
+    /** First metadata address, i.e. the end of the protected data */
+    Addr metaStart() const { return protectedSize; }
+    /** End of the metadata of this channel, the shadow table included */
+    Addr
+    metaEnd() const
+    {
+        return toGlobal(localMetaEnd() + shadowRegionSize - 1) + 1;
+    }
+
+    bool isData(Addr addr) const { return addr < protectedSize; }
+    /** Whether an address belongs to the channel of this tree */
+    bool inChannel(Addr addr) const { return channelRange.contains(addr); }
+    bool
+    isMac(Addr addr) const
+    {
+        Addr local = toLocal(addr);
+        return local >= macBase && local < macBase + macRegionSize;
+    }
+    /** Whether an address is a counter block, i.e. a level 0 node */
+    bool
+    isCounter(Addr addr) const
+    {
+        return !isData(addr) && !isMac(addr) && levelOf(addr) == 0;
+    }
+    bool
+    isRoot(Addr addr) const
+    {
+        Addr local = toLocal(addr);
+        return local >= levelBases.back() && local < localMetaEnd();
+    }
+
+    /** Number of levels, the counters and the root included, at least 2 */
+    unsigned numLevels() const { return levelBases.size(); }
+    /** Channel-local base address of a level */
+    Addr levelBase(unsigned level) const { return levelBases[level]; }
+    Addr levelSize(unsigned level) const { return levelSizes[level]; }
+
+    /**
+     * Level of a counter or tree node address: 0 for the counters, 1 for
+     * the leaf layer of the tree and numLevels() - 1 for the root.
+     */
+    unsigned levelOf(Addr addr) const;
+
+    /** MAC address of a data address */
+    Addr macAddr(Addr data_addr) const;
+    /** Counter block address of a data address */
+    Addr counterAddr(Addr data_addr) const;
+    /** Address of the tree node covering a counter or tree node */
+    Addr parentAddr(Addr addr) const;
+    /** Number of children of a node of a level */
+    unsigned
+    arity(unsigned level) const
+    {
+        return level == 0 ? counterArity : treeArity;
+    }
+    /**
+     * Address of the i-th child of a counter or tree node: a data block
+     * for a counter, a node of the level below otherwise. MaxAddr if the
+     * child lies past the end of its level.
+     */
+    Addr childAddr(Addr addr, unsigned i) const;
+
+    /** Size in bytes of a shadow table entry */
+    static constexpr unsigned shadowEntrySize = sizeof(Addr);
+    unsigned getShadowEntries() const { return shadowEntries; }
+    /** Address of an entry of the shadow table */
+    Addr shadowAddr(unsigned entry) const;
+    /** Number of blocks read to scan the whole shadow table */
+    Addr shadowBlocks() const { return shadowRegionSize / blockSize; }
+};
+
+} // namespace gem5
+
+#endif // __CACHET_INTEGRITY_LAYOUT_HH__
@@ -0,0 +1,184 @@
+#include <gtest/gtest.h>
+
+#include "cachet/integrity_layout.hh"
+
+using namespace gem5;
+
+namespace
+{
+
+/**
+ * 1 MiB of data in 64 byte blocks, 8 byte MACs, 64 blocks per counter
+ * block and 8-ary tree nodes. The MACs take 128 KiB after the data, then
+ * come 256 counter blocks, 32 leaves, 4 inner nodes and the root.
+ */
+IntegrityLayoutParams
+layoutParams(AddrRange channel_range=AddrRange(0, 0x400000))
+{
+    IntegrityLayoutParams p;
+    p.name = "layout";
+    p.eventq_index = 0;
+    p.protected_size = 0x100000;
+    p.block_size = 64;
+    p.mac_size = 8;
+    p.counter_arity = 64;
+    p.tree_arity = 8;
+    p.channel_range = channel_range;
+    p.split_counters = false;
+    p.mac_in_ecc = false;
+    p.major_counter_bits = 0;
+    p.minor_counter_bits = 0;
+    p.shadow_entries = 0;
+    p.row_data_bytes = 0;
+    return p;
+}
+
+} // anonymous namespace
+
+TEST(IntegrityLayoutTest, LevelBoundaries)
+{
+    IntegrityLayout layout(layoutParams());
+
+    ASSERT_EQ(4U, layout.numLevels());
+    EXPECT_EQ(0x120000, layout.levelBase(0));
+    EXPECT_EQ(0x4000, layout.levelSize(0));
+    EXPECT_EQ(0x124000, layout.levelBase(1));
+    EXPECT_EQ(0x800, layout.levelSize(1));
+    EXPECT_EQ(0x124800, layout.levelBase(2));
+    EXPECT_EQ(0x100, layout.levelSize(2));
+    EXPECT_EQ(0x124900, layout.levelBase(3));
+    EXPECT_EQ(0x40, layout.levelSize(3));
+
+    EXPECT_EQ(0x100000, layout.metaStart());
+    EXPECT_EQ(0x124940, layout.metaEnd());
+
+    // First and last block of every level
+    for (unsigned level = 0; level < layout.numLevels(); level++) {
+        Addr base = layout.levelBase(level);
+        Addr last = base + layout.levelSize(level) - 64;
+        EXPECT_EQ(level, layout.levelOf(base));
+        EXPECT_EQ(level, layout.levelOf(last));
+    }
+
+    EXPECT_TRUE(layout.isData(0xfffc0));
+    EXPECT_FALSE(layout.isData(0x100000));
+    EXPECT_TRUE(layout.isMac(0x100000));
+    EXPECT_TRUE(layout.isMac(0x11ffc0));
+    EXPECT_FALSE(layout.isMac(0x120000));
+    EXPECT_TRUE(layout.isCounter(0x120000));
+    EXPECT_TRUE(layout.isCounter(0x123fc0));
+    EXPECT_FALSE(layout.isCounter(0x124000));
+}
+
+TEST(IntegrityLayoutTest, Root)
+{
+    IntegrityLayout layout(layoutParams());
+
+    EXPECT_TRUE(layout.isRoot(0x124900));
+    EXPECT_FALSE(layout.isRoot(0x1248c0));
+    EXPECT_FALSE(layout.isRoot(0x124940));
+
+    // Every walk from a data block ends at the single root
+    for (Addr data : {Addr(0), Addr(0x80000), Addr(0xfffc0)}) {
+        Addr node = layout.counterAddr(data);
+        for (unsigned level = 0; level + 1 < layout.numLevels(); level++) {
+            EXPECT_FALSE(layout.isRoot(node));
+            node = layout.parentAddr(node);
+        }
+        EXPECT_EQ(0x124900, node);
+        EXPECT_TRUE(layout.isRoot(node));
+    }
+}
+
+TEST(IntegrityLayoutTest, ChildAddr)
+{
+    IntegrityLayout layout(layoutParams());
+
+    // The children of a node are the nodes it is the parent of
+    Addr leaf = 0x124000 + 5 * 64;
+    for (unsigned i = 0; i < 8; i++) {
+        Addr child = layout.childAddr(leaf, i);
+        EXPECT_EQ(0x120000 + (5 * 8 + i) * 64, child);
+        EXPECT_EQ(leaf, layout.parentAddr(child));
+    }
+    EXPECT_EQ(0xfc0, layout.childAddr(0x120000, 63));
+    EXPECT_EQ(0x1000, layout.childAddr(0x120040, 0));
+    EXPECT_EQ(0xfffc0, layout.childAddr(0x123fc0, 63));
+
+    // The root has only 4 children out of 8
+    for (unsigned i = 0; i < 4; i++)
+        EXPECT_EQ(0x124800 + i * 64, layout.childAddr(0x124900, i));
+    for (unsigned i = 4; i < 8; i++)
+        EXPECT_EQ(MaxAddr, layout.childAddr(0x124900, i));
+}
+
+/* A counter block past the end of the data covers fewer blocks */
+TEST(IntegrityLayoutTest, ChildAddrPastData)
+{
+    auto p = layoutParams();
+    p.protected_size = 65 * 64;
+    IntegrityLayout layout(p);
+
+    Addr last_counter = layout.counterAddr(64 * 64);
+    EXPECT_EQ(layout.levelBase(0) + 64, last_counter);
+    EXPECT_EQ(64 * 64, layout.childAddr(last_counter, 0));
+    EXPECT_EQ(MaxAddr, layout.childAddr(last_counter, 1));
+    EXPECT_EQ(MaxAddr, layout.childAddr(last_counter, 63));
+}
+
+/*
+ * Two channels interleaved every 256 bytes: the second channel protects
+ * half of the data, and its tree is laid out in its own address space.
+ */
+TEST(IntegrityLayoutTest, InterleavedChannel)
+{
+    AddrRange range(0, 0x400000, {Addr(1) << 8}, 1);
+    IntegrityLayout layout(layoutParams(range));
+
+    EXPECT_EQ(0x0, layout.toLocal(0x100));
+    EXPECT_EQ(0xc0, layout.toLocal(0x1c0));
+    EXPECT_EQ(0x100, layout.toLocal(0x300));
+    EXPECT_EQ(0x100, layout.toGlobal(0x0));
+    EXPECT_EQ(0x300, layout.toGlobal(0x100));
+
+    // Channel-local addresses are dense, and map back to the channel
+    Addr expected_local = 0;
+    for (Addr addr = 0; addr < 0x4000; addr += 64) {
+        if (!layout.inChannel(addr))
+            continue;
+        EXPECT_EQ(expected_local, layout.toLocal(addr));
+        EXPECT_EQ(addr, layout.toGlobal(layout.toLocal(addr)));
+        expected_local += 64;
+    }
+    EXPECT_EQ(0x2000, expected_local);
+
+    // 512 KiB of local data: 64 KiB of MACs, 128 counter blocks, 16
+    // leaves, 2 inner nodes and the root
+    ASSERT_EQ(4U, layout.numLevels());
+    EXPECT_EQ(0x90000, layout.levelBase(0));
+    EXPECT_EQ(0x92000, layout.levelBase(1));
+    EXPECT_EQ(0x92400, layout.levelBase(2));
+    EXPECT_EQ(0x92480, layout.levelBase(3));
+    EXPECT_EQ(0x100000, layout.metaStart());
+    EXPECT_EQ(layout.toGlobal(0x924c0 - 1) + 1, layout.metaEnd());
+
+    // All the metadata of the channel stays in the channel
+    Addr data = 0xfffc0;
+    ASSERT_TRUE(layout.inChannel(data));
+    Addr mac = layout.macAddr(data);
+    EXPECT_TRUE(layout.inChannel(mac));
+    EXPECT_TRUE(layout.isMac(mac));
+
+    Addr node = layout.counterAddr(data);
+    EXPECT_TRUE(layout.isCounter(node));
+    while (!layout.isRoot(node)) {
+        EXPECT_TRUE(layout.inChannel(node));
+        EXPECT_LT(node, layout.metaEnd());
+        node = layout.parentAddr(node);
+    }
+    EXPECT_EQ(layout.toGlobal(0x92480), node);
+    EXPECT_TRUE(layout.inChannel(node));
+
+    // The last counter block covers the last data block of the channel
+    EXPECT_EQ(data, layout.childAddr(layout.counterAddr(data), 63));
+}
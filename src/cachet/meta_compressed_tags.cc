@@ -0,0 +1,58 @@
+#include "cachet/meta_compressed_tags.hh"
+
+#include "base/trace.hh"
+#include "debug/MetaTags.hh"
+#include "mem/cache/tags/super_blk.hh"
+
+namespace gem5
+{
+
+MetaCompressedTags::MetaCompressedTags(const MetaCompressedTagsParams &p) :
+    CompressedTags(p),
+    layout(p.layout),
+    metaStats(*this)
+{
+}
+
+CacheBlk *
+MetaCompressedTags::findVictim(Addr addr, const bool is_secure,
+                               const std::size_t compressed_size,
+                               std::vector<CacheBlk*> &evict_blks)
+{
+    if (!layout->isCounter(addr)) {
+        // The compressor leaves it at full size, it never shares its
+        // data entry
+        return CompressedTags::findVictim(addr, is_secure,
+                compressed_size, evict_blks);
+    }
+
+    const size_t evictions = evict_blks.size();
+    CacheBlk *victim = CompressedTags::findVictim(addr, is_secure,
+            compressed_size, evict_blks);
+    metaStats.counterFills++;
+
+    // Nothing was evicted and the superblock already holds blocks
+    const SectorBlk *superblock =
+        static_cast<CompressionBlk*>(victim)->getSectorBlock();
+    if (evict_blks.size() == evictions && superblock->getNumValid() > 0) {
+        DPRINTF(MetaTags, "Counter %#x of %d bits co-allocated\n", addr,
+                compressed_size);
+        metaStats.coAllocations++;
+    }
+    return victim;
+}
+
+MetaCompressedTags::MetaCompressedTagsStats::MetaCompressedTagsStats(
+        MetaCompressedTags &tags) :
+    statistics::Group(&tags),
+    ADD_STAT(counterFills, statistics::units::Count::get(),
+             "Counter blocks allocated"),
+    ADD_STAT(coAllocations, statistics::units::Count::get(),
+             "Counter blocks sharing a data entry with another one"),
+    ADD_STAT(coAllocationRate, statistics::units::Ratio::get(),
+             "Fraction of the counter fills that were co-allocated")
+{
+    coAllocationRate = coAllocations / counterFills;
+}
+
+} // namespace gem5
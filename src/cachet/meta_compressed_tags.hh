@@ -0,0 +1,47 @@
+#ifndef __CACHET_META_COMPRESSED_TAGS_HH__
+#define __CACHET_META_COMPRESSED_TAGS_HH__
+
+#include <vector>
+
+#include "base/statistics.hh"
+#include "cachet/integrity_layout.hh"
+#include "mem/cache/tags/compressed_tags.hh"
+#include "params/MetaCompressedTags.hh"
+
+namespace gem5
+{
+
+/**
+ * Compressed tag store of the meta cache, where the counter blocks of a
+ * superblock share a data entry when they compress well enough.
+ *
+ * Only counter blocks are co-allocated: MACs and tree nodes are hashes,
+ * which do not compress, so the compressor leaves them at full size and
+ * they are stored alone in their superblock, in a whole data entry. The
+ * kind-aware replacement of MetaTags is not available on this tag store.
+ */
+class MetaCompressedTags : public CompressedTags
+{
+  private:
+    IntegrityLayout *layout;
+
+    struct MetaCompressedTagsStats : public statistics::Group
+    {
+        MetaCompressedTagsStats(MetaCompressedTags &tags);
+
+        statistics::Scalar counterFills;
+        statistics::Scalar coAllocations;
+        statistics::Formula coAllocationRate;
+    } metaStats;
+
+  public:
+    MetaCompressedTags(const MetaCompressedTagsParams &p);
+
+    CacheBlk *findVictim(Addr addr, const bool is_secure,
+                         const std::size_t compressed_size,
+                         std::vector<CacheBlk*> &evict_blks) override;
+};
+
+} // namespace gem5
+
+#endif // __CACHET_META_COMPRESSED_TAGS_HH__
@@ -0,0 +1,188 @@
+#include "cachet/meta_prefetcher.hh"
+
+#include "base/intmath.hh"
+#include "base/trace.hh"
+#include "debug/MetaPrefetcher.hh"
+
+namespace gem5
+{
+
+MetaPrefetcher::MetaPrefetcher(const MetaPrefetcherParams &p) :
+    BaseCtrl(p),
+    degree(p.degree),
+    prefetchTree(p.prefetch_tree),
+    filterEntries(p.filter_entries),
+    lastBlock(MaxAddr),
+    direction(0),
+    lastMacLine(MaxAddr),
+    lastCounterLine(MaxAddr),
+    pfStats(*this)
+{
+    DPRINTF(MetaPrefetcher, "Constructing\n");
+    fatal_if(filterEntries < degree * (prefetchTree ? 3 : 2),
+            "%s: the filter must hold the lines of at least one round of "
+            "prefetches", name());
+}
+
+MetaPrefetcher::FilterEntry *
+MetaPrefetcher::findFilter(Addr line)
+{
+    for (auto &entry : filter) {
+        if (entry.addr == line) {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+void
+MetaPrefetcher::prefetch(Addr line, RequestorID id)
+{
+    if (findFilter(line)) {
+        pfStats.filtered++;
+        return;
+    }
+
+    if (filter.size() == filterEntries) {
+        if (!filter.front().used) {
+            pfStats.unused++;
+        }
+        filter.pop_front();
+    }
+    filter.push_back({line, false});
+
+    DPRINTF(MetaPrefetcher, "Prefetch %#x\n", line);
+    pfStats.issued++;
+
+    PacketPtr pkt = createPkt(
+            line,
+            layout->getBlockSize(),
+            0,
+            id,
+            true
+            );
+    memSidePort.sendPacket(pkt);
+}
+
+void
+MetaPrefetcher::checkDemand(Addr line, Addr &last_line)
+{
+    // Only count each line once per run of accesses touching it
+    if (line == last_line) {
+        return;
+    }
+    last_line = line;
+
+    FilterEntry *entry = findFilter(line);
+    if (entry && !entry->used) {
+        entry->used = true;
+        pfStats.useful++;
+    } else if (!entry) {
+        pfStats.uncovered++;
+    }
+}
+
+void
+MetaPrefetcher::notify(PacketPtr pkt)
+{
+    const unsigned block_size = layout->getBlockSize();
+    Addr addr = pkt->getAddr();
+    // No new prefetch holds up a drain
+    if (!layout->isData(addr) || drainState() != DrainState::Running) {
+        return;
+    }
+
+    if (!layout->hasMacInEcc()) {
+        checkDemand(roundDown(layout->macAddr(addr), block_size),
+                lastMacLine);
+    }
+    checkDemand(layout->counterAddr(addr), lastCounterLine);
+
+    Addr block = roundDown(layout->toLocal(addr), block_size);
+    if (block == lastBlock) {
+        return;
+    }
+
+    int stride = 0;
+    if (block == lastBlock + block_size) {
+        stride = 1;
+    } else if (block + block_size == lastBlock) {
+        stride = -1;
+    }
+    lastBlock = block;
+
+    if (stride == 0) {
+        direction = 0;
+        return;
+    }
+    if (stride != direction) {
+        pfStats.streams++;
+        direction = stride;
+    }
+
+    // A MAC line covers block_size / mac_size data blocks, fetch the ones
+    // of the next lines of the stream along with their counters
+    const Addr mac_span = (Addr)block_size / layout->getMacSize() *
+        block_size;
+    Addr local = roundDown(block, mac_span);
+    for (unsigned i = 1; i <= degree; i++) {
+        if (direction < 0 && local < i * mac_span) {
+            break;
+        }
+        Addr target = direction > 0 ? local + i * mac_span :
+            local - i * mac_span;
+        Addr data = layout->toGlobal(target);
+        if (!layout->isData(data)) {
+            break;
+        }
+
+        RequestorID id = pkt->req->requestorId();
+        if (!layout->hasMacInEcc()) {
+            prefetch(roundDown(layout->macAddr(data), block_size), id);
+        }
+        Addr counter = layout->counterAddr(data);
+        prefetch(counter, id);
+        if (prefetchTree) {
+            prefetch(layout->parentAddr(counter), id);
+        }
+    }
+}
+
+bool
+MetaPrefetcher::handleResponse(PacketPtr pkt)
+{
+    DPRINTF(MetaPrefetcher, "Prefetch of %#x done\n", pkt->getAddr());
+    recordMetaResponse(pkt);
+    destroyPkt(pkt);
+    return true;
+}
+
+MetaPrefetcher::MetaPrefetcherStats::MetaPrefetcherStats(
+        MetaPrefetcher &pf) :
+    statistics::Group(&pf),
+    ADD_STAT(streams, statistics::units::Count::get(),
+             "Number of streams detected"),
+    ADD_STAT(issued, statistics::units::Count::get(),
+             "Number of metadata lines prefetched"),
+    ADD_STAT(filtered, statistics::units::Count::get(),
+             "Prefetches dropped because the line was fetched recently"),
+    ADD_STAT(useful, statistics::units::Count::get(),
+             "Prefetched lines later demanded by a data access"),
+    ADD_STAT(uncovered, statistics::units::Count::get(),
+             "Demanded metadata lines that were not prefetched"),
+    ADD_STAT(unused, statistics::units::Count::get(),
+             "Prefetched lines that left the filter without being "
+             "demanded"),
+    ADD_STAT(accuracy, statistics::units::Ratio::get(),
+             "Fraction of the prefetched lines that were demanded"),
+    ADD_STAT(coverage, statistics::units::Ratio::get(),
+             "Fraction of the demanded lines that were prefetched")
+{
+    accuracy.precision(4);
+    accuracy = useful / issued;
+
+    coverage.precision(4);
+    coverage = useful / (useful + uncovered);
+}
+
+} // namespace gem5
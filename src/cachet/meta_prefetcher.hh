@@ -0,0 +1,76 @@
+#ifndef __CACHET_META_PREFETCHER_HH__
+#define __CACHET_META_PREFETCHER_HH__
+
+#include <deque>
+
+#include "cachet/base_ctrl.hh"
+#include "params/MetaPrefetcher.hh"
+
+namespace gem5
+{
+
+/**
+ * Stream prefetcher for the integrity metadata. SecCtrl reports every
+ * data access it accepts; once two accesses to neighbouring blocks of the
+ * channel show a stream, the MAC lines (and the counter lines covering
+ * them) of the next data blocks of the stream are fetched into the meta
+ * cache ahead of the verification walks. Only the mem side port is used.
+ */
+class MetaPrefetcher : public BaseCtrl
+{
+  private:
+    /** A line recently prefetched, kept to filter duplicates */
+    struct FilterEntry
+    {
+        Addr addr;
+        bool used;
+    };
+
+    /** Number of MAC lines fetched ahead of the stream */
+    const unsigned degree;
+    /** Also fetch the leaf tree node of every prefetched counter */
+    const bool prefetchTree;
+    const unsigned filterEntries;
+
+    /** Channel-local address of the last data block accessed */
+    Addr lastBlock;
+    /** Direction of the current stream, 0 if there is none */
+    int direction;
+
+    /** Last MAC and counter lines demanded by the data accesses */
+    Addr lastMacLine;
+    Addr lastCounterLine;
+
+    /** Recently prefetched lines, oldest first */
+    std::deque<FilterEntry> filter;
+
+    FilterEntry *findFilter(Addr line);
+    void prefetch(Addr line, RequestorID id);
+    void checkDemand(Addr line, Addr &last_line);
+
+    bool handleResponse(PacketPtr pkt) override;
+
+    struct MetaPrefetcherStats : public statistics::Group
+    {
+        MetaPrefetcherStats(MetaPrefetcher &pf);
+
+        statistics::Scalar streams;
+        statistics::Scalar issued;
+        statistics::Scalar filtered;
+        statistics::Scalar useful;
+        statistics::Scalar uncovered;
+        statistics::Scalar unused;
+        statistics::Formula accuracy;
+        statistics::Formula coverage;
+    } pfStats;
+
+  public:
+    MetaPrefetcher(const MetaPrefetcherParams &p);
+
+    /** Observe a data access accepted by SecCtrl */
+    void notify(PacketPtr pkt);
+};
+
+} // namespace gem5
+
+#endif // __CACHET_META_PREFETCHER_HH__
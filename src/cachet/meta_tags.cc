@@ -0,0 +1,144 @@
+#include "cachet/meta_tags.hh"
+
+#include <algorithm>
+#include <string>
+
+#include "base/trace.hh"
+#include "debug/MetaTags.hh"
+
+namespace gem5
+{
+
+MetaTags::MetaTags(const MetaTagsParams &p) :
+    BaseSetAssoc(p),
+    layout(p.layout),
+    macWays(p.mac_ways),
+    counterWays(p.counter_ways),
+    treeWays(p.tree_ways),
+    keepUpperLevels(p.keep_upper_levels),
+    metaStats(*this)
+{
+    fatal_if(std::max({macWays, counterWays, treeWays}) > allocAssoc,
+            "%s: a way cap is larger than the associativity", name());
+}
+
+unsigned
+MetaTags::rankOf(Addr addr) const
+{
+    if (layout->isData(addr) || layout->isMac(addr)) {
+        return 0;
+    }
+    return layout->levelOf(addr) + 1;
+}
+
+unsigned
+MetaTags::waysOf(unsigned rank) const
+{
+    if (rank == 0) {
+        return macWays;
+    }
+    return rank == 1 ? counterWays : treeWays;
+}
+
+bool
+MetaTags::sameKind(unsigned rank_a, unsigned rank_b) const
+{
+    return std::min(rank_a, 2U) == std::min(rank_b, 2U);
+}
+
+CacheBlk *
+MetaTags::findVictim(Addr addr, const bool is_secure, const std::size_t size,
+                     std::vector<CacheBlk*> &evict_blks)
+{
+    const std::vector<ReplaceableEntry*> entries =
+        indexingPolicy->getPossibleEntries(addr);
+    const unsigned rank = rankOf(addr);
+
+    std::vector<unsigned> ranks(entries.size());
+    unsigned same_kind = 0;
+    for (size_t i = 0; i < entries.size(); i++) {
+        CacheBlk *blk = static_cast<CacheBlk*>(entries[i]);
+        if (blk->isValid()) {
+            ranks[i] = rankOf(regenerateBlkAddr(blk));
+            same_kind += sameKind(ranks[i], rank);
+        }
+    }
+
+    std::vector<ReplaceableEntry*> candidates;
+    const unsigned cap = waysOf(rank);
+    if (cap && same_kind >= cap) {
+        // The kind is at its cap, it replaces one of its own blocks
+        for (size_t i = 0; i < entries.size(); i++) {
+            CacheBlk *blk = static_cast<CacheBlk*>(entries[i]);
+            if (blk->isValid() && sameKind(ranks[i], rank)) {
+                candidates.push_back(entries[i]);
+            }
+        }
+        metaStats.capVictims++;
+    } else if (keepUpperLevels) {
+        for (size_t i = 0; i < entries.size(); i++) {
+            CacheBlk *blk = static_cast<CacheBlk*>(entries[i]);
+            if (!blk->isValid() || ranks[i] <= rank) {
+                candidates.push_back(entries[i]);
+            }
+        }
+        if (candidates.empty()) {
+            // The set only holds upper nodes, one of them has to go
+            metaStats.priorityFallbacks++;
+            candidates = entries;
+        } else if (candidates.size() < entries.size()) {
+            metaStats.priorityVictims++;
+        }
+    } else {
+        candidates = entries;
+    }
+
+    CacheBlk *victim = static_cast<CacheBlk*>(
+            replacementPolicy->getVictim(candidates));
+    if (victim->isValid()) {
+        unsigned victim_rank = rankOf(regenerateBlkAddr(victim));
+        DPRINTF(MetaTags, "Rank %d miss at %#x evicts rank %d\n", rank,
+                addr, victim_rank);
+        metaStats.evictions[victim_rank]++;
+    }
+    metaStats.fills[rank]++;
+
+    evict_blks.push_back(victim);
+    return victim;
+}
+
+MetaTags::MetaTagsStats::MetaTagsStats(MetaTags &_tags) :
+    statistics::Group(&_tags),
+    tags(_tags),
+    ADD_STAT(fills, statistics::units::Count::get(),
+             "Blocks allocated per kind of metadata"),
+    ADD_STAT(evictions, statistics::units::Count::get(),
+             "Valid blocks evicted per kind of metadata"),
+    ADD_STAT(capVictims, statistics::units::Count::get(),
+             "Victims chosen within a kind at its way cap"),
+    ADD_STAT(priorityVictims, statistics::units::Count::get(),
+             "Victims chosen with the upper levels of the set protected"),
+    ADD_STAT(priorityFallbacks, statistics::units::Count::get(),
+             "Misses that had to evict a node of an upper level")
+{
+}
+
+void
+MetaTags::MetaTagsStats::regStats()
+{
+    statistics::Group::regStats();
+
+    const unsigned ranks = tags.layout->numLevels() + 1;
+    fills.init(ranks);
+    evictions.init(ranks);
+    for (unsigned rank = 0; rank < ranks; rank++) {
+        std::string name = rank == 0 ? "mac" : rank == 1 ? "counter" :
+            "level" + std::to_string(rank - 1);
+        fills.subname(rank, name);
+        evictions.subname(rank, name);
+    }
+    fills.flags(statistics::nozero);
+    evictions.flags(statistics::nozero);
+}
+
+} // namespace gem5
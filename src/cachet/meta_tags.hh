@@ -0,0 +1,71 @@
+#ifndef __CACHET_META_TAGS_HH__
+#define __CACHET_META_TAGS_HH__
+
+#include <vector>
+
+#include "base/statistics.hh"
+#include "cachet/integrity_layout.hh"
+#include "mem/cache/tags/base_set_assoc.hh"
+#include "params/MetaTags.hh"
+
+namespace gem5
+{
+
+/**
+ * Tag store of the meta cache, aware of the kind of metadata each block
+ * holds: a MAC line, a counter block or a node of a tree level.
+ *
+ * Each kind can be capped to a number of ways of a set. A miss of a kind
+ * at its cap evicts a block of the same kind, so a stream of MAC misses
+ * cannot flush the counters and the tree. Otherwise, with
+ * keepUpperLevels, a miss only evicts blocks of its own level or below
+ * when the set has one, as an upper node covers far more data and is
+ * needed by almost every verification walk. The replacement policy picks
+ * the victim among the remaining candidates.
+ */
+class MetaTags : public BaseSetAssoc
+{
+  private:
+    IntegrityLayout *layout;
+
+    /** Way cap of the MACs, the counters and the tree, 0 for none */
+    const unsigned macWays;
+    const unsigned counterWays;
+    const unsigned treeWays;
+    const bool keepUpperLevels;
+
+    /**
+     * Rank of a metadata address: 0 for a MAC, 1 for a counter and
+     * 1 + level for a tree node, so that higher ranks protect more data.
+     */
+    unsigned rankOf(Addr addr) const;
+    /** Way cap of the kind of a rank */
+    unsigned waysOf(unsigned rank) const;
+    bool sameKind(unsigned rank_a, unsigned rank_b) const;
+
+    struct MetaTagsStats : public statistics::Group
+    {
+        MetaTagsStats(MetaTags &tags);
+
+        void regStats() override;
+
+        MetaTags &tags;
+
+        statistics::Vector fills;
+        statistics::Vector evictions;
+        statistics::Scalar capVictims;
+        statistics::Scalar priorityVictims;
+        statistics::Scalar priorityFallbacks;
+    } metaStats;
+
+  public:
+    MetaTags(const MetaTagsParams &p);
+
+    CacheBlk *findVictim(Addr addr, const bool is_secure,
+                         const std::size_t size,
+                         std::vector<CacheBlk*> &evict_blks) override;
+};
+
+} // namespace gem5
+
+#endif // __CACHET_META_TAGS_HH__
@@ -1,5 +1,7 @@
 #include "cachet/mt_write.hh"
 
+#include <algorithm>
+
 #include "base/trace.hh"
 #include "debug/MTWrite.hh"
 
@@ -10,117 +12,308 @@ MTWrite::MTWrite(const MTWriteParams &p) :
     BaseCtrl(p),
     requestOperation([this]{ processRequestOperation(); }, name()),
     nextMTOperation([this]{ processNextMTOperation(); }, name()),
+    flushOperation([this]{ processFlushOperation(); }, name()),
     memBypassPort(name() + ".mem_bypass_port", this),
     requestPkt(nullptr),
-    responsePkt(nullptr)
+    responsePkt(nullptr),
+    updateLevels(0),
+    counters(*this, memBypassPort),
+    persist(*this, memBypassPort, p.persist_mode, p.root_persist_latency,
+            p.recovery_block_time),
+    dirtyBufferEntries(p.dirty_buffer_entries),
+    flushing(false),
+    flushOutstanding(0),
+    flushRequestorId(0),
+    mtStats(*this)
 {
     DPRINTF(MTWrite, "Constructing\n");
+    fatal_if(persist.enabled() && lazyUpdate(), "%s: the persist modes "
+            "need every update to reach the root", name());
 }
 
 void
 MTWrite::processRequestOperation()
 {
-    Addr offset = requestPkt->getAddr() >> 8 << 5;
-    PacketPtr macPkt = createPkt(
-            MAC_START + offset,
-            8,
-            requestPkt->req->getFlags(),
-            requestPkt->req->requestorId(),
-            false
-            );
-    memBypassPort.sendPacket(macPkt);
-
-    offset = (macPkt->getAddr() - MAC_START) >> 11 << 8;
-    PacketPtr cntPkt = createPkt(
-            CNT_START + offset,
-            64,
-            macPkt->req->getFlags(),
-            macPkt->req->requestorId(),
-            false
-            );
+    // A MAC travelling with its data is written along with it
+    if (!layout->hasMacInEcc()) {
+        PacketPtr macPkt = createPkt(
+                layout->macAddr(requestPkt->getAddr()),
+                layout->getMacSize(),
+                requestPkt->req->getFlags(),
+                requestPkt->req->requestorId(),
+                false
+                );
+        mtStats.bypassPkts++;
+        mtStats.bypassBytes += macPkt->getSize();
+        persist.watch(macPkt);
+        memBypassPort.sendPacket(macPkt);
+    }
+
+    PacketPtr cntPkt = counters.createCounterPkt(requestPkt);
+    mtStats.bypassPkts++;
+    mtStats.bypassBytes += cntPkt->getSize();
     memBypassPort.sendPacket(cntPkt);
+    updateLevels = 1;
 }
 
 void
 MTWrite::processNextMTOperation()
 {
     PacketPtr pkt = responsePkt;
-    if (pkt->getAddr() < CNT_START) {
-        assert(false);
-    } else if (pkt->getAddr() >= CNT_START &&
-            pkt->getAddr() < MT_START) {
-        Addr offset = (pkt->getAddr() - CNT_START) >> 11 << 8;
-        PacketPtr mtPkt = createPkt(
-                MT_START + offset,
-                64,
-                pkt->req->getFlags(),
-                pkt->req->requestorId(),
-                false
+    assert(!layout->isMac(pkt->getAddr()));
+
+    if (layout->isRoot(pkt->getAddr())) {
+        // Root
+        schedule(
+                finishOperation,
+                reserveHash() + persist.persistRoot()
                 );
-        memSidePort.sendPacket(mtPkt);
         return;
-    } else {
-        Addr layer_start = MT_START;
-        Addr layer_size = 0x10000000 >> 3;
-        for (int i=0; i<10; i++) {
-            if (layer_start == RT_START) {
-                // Root
-                schedule(
-                        finishOperation,
-                        curTick() + HASH_CYCLE * TICK_PER_CYCLE
-                        );
-                return;
-            }
-
-            if (pkt->getAddr() < layer_start+layer_size) {
-                // Layer 0 is the leaf of MT
-                DPRINTF(MTWrite, "send pkt in layer %d\n", i+1);
-                Addr offset = (pkt->getAddr() - layer_start) >> 11 << 8;
-                PacketPtr mtPkt = createPkt(
-                        layer_start + layer_size + offset,
-                        64,
-                        pkt->req->getFlags(),
-                        pkt->req->requestorId(),
-                        false
-                        );
-                memSidePort.sendPacket(mtPkt);
-                return;
-            }
-            layer_start += layer_size;
-            layer_size >>= 3;
-        }
     }
 
-    assert(false);
+    // Level 1 is the leaf of MT
+    Addr addr = layout->parentAddr(pkt->getAddr());
+    DPRINTF(MTWrite, "send pkt in level %d\n", layout->levelOf(addr));
+    PacketPtr mtPkt = createPkt(
+            addr,
+            layout->getBlockSize(),
+            pkt->req->getFlags(),
+            pkt->req->requestorId(),
+            false
+            );
+    updateLevels++;
+    memSidePort.sendPacket(mtPkt);
+    destroyPkt(responsePkt);
+    responsePkt = nullptr;
 }
 
 void
 MTWrite::processFinishOperation()
 {
-    cpuSidePort.sendPacket(responsePkt);
+    // Persist barrier, the write is only acknowledged once its MAC and
+    // the nodes it dirtied are covered in memory
+    if (persist.busy()) {
+        persist.startBarrier();
+        return;
+    }
+
+    mtStats.updateLevels.sample(updateLevels);
+    updateLevels = 0;
+
+    PacketPtr pkt = requestPkt;
     requestPkt = nullptr;
-    responsePkt = nullptr;
-    cpuSidePort.trySendRetry();
-    return;
+    if (responsePkt) {
+        destroyPkt(responsePkt);
+        responsePkt = nullptr;
+    }
+    pkt->makeResponse();
+    cpuSidePort.sendPacket(pkt);
+
+    // A drain also pushes the buffered updates to the root
+    if (lazyUpdate() && !dirtyNodes.empty() &&
+            (dirtyNodes.size() >= dirtyBufferEntries ||
+             drainState() == DrainState::Draining)) {
+        startFlush();
+    } else {
+        cpuSidePort.trySendRetry();
+        checkDrain();
+    }
+}
+
+bool
+MTWrite::isIdle() const
+{
+    return !requestPkt && !flushing && dirtyNodes.empty() &&
+        !persist.busy() && !counters.busy() && memBypassPort.isIdle() &&
+        BaseCtrl::isIdle();
+}
+
+DrainState
+MTWrite::drain()
+{
+    if (!requestPkt && !flushing && !dirtyNodes.empty()) {
+        startFlush();
+    }
+    return BaseCtrl::drain();
+}
+
+void
+MTWrite::serialize(CheckpointOut &cp) const
+{
+    // The dirty buffer is flushed by the drain, only the counters are
+    // left to save
+    assert(dirtyNodes.empty());
+    if (counters.enabled()) {
+        counters.serializeSection(cp, "splitCounters");
+    }
+    if (persist.enabled()) {
+        persist.serializeSection(cp, "persistTracker");
+    }
+}
+
+void
+MTWrite::unserialize(CheckpointIn &cp)
+{
+    if (counters.enabled()) {
+        counters.unserializeSection(cp, "splitCounters");
+    }
+    if (persist.enabled()) {
+        persist.unserializeSection(cp, "persistTracker");
+    }
+}
+
+void
+MTWrite::markDirty(Addr addr)
+{
+    if (std::find(dirtyNodes.begin(), dirtyNodes.end(), addr) !=
+            dirtyNodes.end()) {
+        DPRINTF(MTWrite, "Coalesce update of %#x\n", addr);
+        mtStats.coalescedUpdates++;
+        return;
+    }
+    dirtyNodes.push_back(addr);
+}
+
+void
+MTWrite::startFlush()
+{
+    DPRINTF(MTWrite, "Flush %d dirty nodes\n", dirtyNodes.size());
+    assert(!flushing && !dirtyNodes.empty());
+
+    flushing = true;
+    mtStats.flushes++;
+    flushNodes.assign(dirtyNodes.begin(), dirtyNodes.end());
+    dirtyNodes.clear();
+    flushNextLevel();
+}
+
+void
+MTWrite::flushNextLevel()
+{
+    // Every distinct parent of the current level is rehashed once
+    std::vector<Addr> parents;
+    for (auto addr : flushNodes) {
+        parents.push_back(layout->parentAddr(addr));
+    }
+    std::sort(parents.begin(), parents.end());
+    parents.erase(std::unique(parents.begin(), parents.end()),
+            parents.end());
+    flushNodes = parents;
+
+    Tick ready = curTick();
+    for (size_t i = 0; i < flushNodes.size(); i++) {
+        ready = std::max(ready, reserveHash());
+    }
+    schedule(flushOperation, ready);
+}
+
+void
+MTWrite::processFlushOperation()
+{
+    DPRINTF(MTWrite, "Flush %d nodes in level %d\n", flushNodes.size(),
+            layout->levelOf(flushNodes.front()));
+
+    for (auto addr : flushNodes) {
+        PacketPtr pkt = createPkt(
+                addr,
+                layout->getBlockSize(),
+                0,
+                flushRequestorId,
+                false
+                );
+        flushOutstanding++;
+        mtStats.flushedNodes++;
+        memSidePort.sendPacket(pkt);
+    }
+}
+
+void
+MTWrite::handleFlushResponse(PacketPtr pkt)
+{
+    assert(flushOutstanding > 0);
+    recordMetaResponse(pkt);
+
+    flushOutstanding--;
+    if (!layout->isRoot(pkt->getAddr()) && !stopsFlush(pkt)) {
+        nextFlushNodes.push_back(pkt->getAddr());
+    }
+    destroyPkt(pkt);
+
+    if (flushOutstanding > 0) {
+        return;
+    }
+
+    if (nextFlushNodes.empty()) {
+        DPRINTF(MTWrite, "Flush done\n");
+        flushing = false;
+        flushNodes.clear();
+        cpuSidePort.trySendRetry();
+        checkDrain();
+    } else {
+        flushNodes.swap(nextFlushNodes);
+        nextFlushNodes.clear();
+        flushNextLevel();
+    }
+}
+
+bool
+MTWrite::handleDeferredResponse(PacketPtr pkt)
+{
+    if (counters.handleResponse(pkt)) {
+        return true;
+    }
+
+    if (persist.handleResponse(pkt)) {
+        // The last persist releases the update waiting on it
+        if (!persist.busy() && persist.endBarrier()) {
+            schedule(finishOperation, curTick());
+        }
+        return true;
+    }
+
+    if (layout->isMac(pkt->getAddr())) {
+        destroyPkt(pkt);
+        return true;
+    }
+
+    if (flushing) {
+        handleFlushResponse(pkt);
+        return true;
+    }
+
+    if (lazyUpdate() && layout->levelOf(pkt->getAddr()) == 0) {
+        // The counter is written, defer the rest of the update
+        assert(requestPkt);
+        markDirty(pkt->getAddr());
+        flushRequestorId = pkt->req->requestorId();
+        responsePkt = pkt;
+        schedule(finishOperation, curTick());
+        return true;
+    }
+
+    return false;
 }
 
 bool
 MTWrite::handleRequest(PacketPtr pkt)
 {
-    if (requestPkt) {
+    if (requestPkt || flushing || counters.busy()) {
         return false;
     }
 
     panic_if(
-            pkt->getAddr() >= AT_START,
-            "Data pkt whose address is over 16GiB"
+            !layout->isData(pkt->getAddr()),
+            "Data pkt whose address is outside of the protected region"
             );
     DPRINTF(MTWrite, "Got request for addr %#x\n", pkt->getAddr());
 
     requestPkt = pkt;
+    if (counters.enabled()) {
+        counters.write(pkt);
+    }
     schedule(
             requestOperation,
-            curTick() + HASH_CYCLE * TICK_PER_CYCLE
+            reserveHash()
             );
     return true;
 }
@@ -128,14 +321,20 @@ MTWrite::handleRequest(PacketPtr pkt)
 bool
 MTWrite::handleResponse(PacketPtr pkt)
 {
-    assert(requestPkt);
     DPRINTF(MTWrite, "Got response for %#x\n", pkt->print());
+    if (handleDeferredResponse(pkt)) {
+        return true;
+    }
+    assert(requestPkt);
 
     // Cnt and MT pkt case
-    if (pkt->getAddr() >= CNT_START) {
-        responsePkt = pkt;
-        schedule(nextMTOperation, curTick() + HASH_CYCLE*TICK_PER_CYCLE);
+    if (layout->levelOf(pkt->getAddr()) > 0) {
+        // Tree nodes go through the meta cache
+        recordMetaResponse(pkt);
+        persist.nodeUpdated(pkt);
     }
+    responsePkt = pkt;
+    schedule(nextMTOperation, reserveHash());
 
     return true;
 }
@@ -145,122 +344,64 @@ MTWrite::handleAtomic(PacketPtr pkt)
 {
     Tick ret = 0;
 
-    Addr offset = pkt->getAddr() >> 8 << 5;
-    PacketPtr macPkt = createPkt(
-            MAC_START + offset,
-            8,
-            pkt->req->getFlags(),
-            pkt->req->requestorId(),
-            false
-            );
-    ret += memBypassPort.sendAtomic(macPkt);
-
-    offset = (macPkt->getAddr() - MAC_START) >> 11 << 8;
-    PacketPtr cntPkt = createPkt(
-            CNT_START + offset,
-            64,
-            macPkt->req->getFlags(),
-            macPkt->req->requestorId(),
-            false
-            );
+    if (counters.enabled()) {
+        counters.increment(pkt->getAddr());
+    }
+
+    if (!layout->hasMacInEcc()) {
+        PacketPtr macPkt = createPkt(
+                layout->macAddr(pkt->getAddr()),
+                layout->getMacSize(),
+                pkt->req->getFlags(),
+                pkt->req->requestorId(),
+                false
+                );
+        ret += memBypassPort.sendAtomic(macPkt);
+        destroyPkt(macPkt);
+    }
+
+    PacketPtr cntPkt = counters.createCounterPkt(pkt);
+    Addr addr = cntPkt->getAddr();
     ret += memBypassPort.sendAtomic(cntPkt);
+    destroyPkt(cntPkt);
 
-    pkt = cntPkt;
-    offset = (pkt->getAddr() - CNT_START) >> 11 << 8;
-    pkt = createPkt(
-            MT_START + offset,
-            64,
-            pkt->req->getFlags(),
-            pkt->req->requestorId(),
-            false
-            );
-    ret += memSidePort.sendAtomic(pkt);
-
-    Addr layer_start = MT_START;
-    Addr layer_size = 0x10000000 >> 3;
-    for (int i=0; i<10; i++) {
-        if (layer_start == RT_START) {
-            // Root
-            ret += HASH_CYCLE * TICK_PER_CYCLE;
-            break;
-        }
+    do {
+        addr = layout->parentAddr(addr);
+        PacketPtr mtPkt = createPkt(
+                addr,
+                layout->getBlockSize(),
+                pkt->req->getFlags(),
+                pkt->req->requestorId(),
+                false
+                );
+        ret += memSidePort.sendAtomic(mtPkt);
+        destroyPkt(mtPkt);
+    } while (!layout->isRoot(addr));
 
-        if (pkt->getAddr() < layer_start+layer_size) {
-            offset = (pkt->getAddr() - layer_start) >> 11 << 8;
-            pkt = createPkt(
-                    layer_start + layer_size + offset,
-                    64,
-                    pkt->req->getFlags(),
-                    pkt->req->requestorId(),
-                    false
-                    );
-            ret += memSidePort.sendAtomic(pkt);
-        }
-        layer_start += layer_size;
-        layer_size >>= 3;
-    }
+    // Root
+    ret += hashEngine->hashLatency() + persist.persistRoot();
 
     return ret;
 }
 
-void
-MTWrite::handleFunctional(PacketPtr pkt)
+MTWrite::MTWriteStats::MTWriteStats(MTWrite &ctrl) :
+    statistics::Group(&ctrl),
+    ADD_STAT(bypassPkts, statistics::units::Count::get(),
+             "Packets sent on the memory bypass port"),
+    ADD_STAT(bypassBytes, statistics::units::Byte::get(),
+             "Bytes sent on the memory bypass port"),
+    ADD_STAT(updateLevels, statistics::units::Count::get(),
+             "Counter and tree levels written per update"),
+    ADD_STAT(coalescedUpdates, statistics::units::Count::get(),
+             "Lazy updates merged with a pending update of the same node"),
+    ADD_STAT(flushes, statistics::units::Count::get(),
+             "Number of dirty buffer flushes"),
+    ADD_STAT(flushedNodes, statistics::units::Count::get(),
+             "Tree nodes rehashed and written by the flushes")
 {
-    Addr offset = pkt->getAddr() >> 8 << 5;
-    PacketPtr macPkt = createPkt(
-            MAC_START + offset,
-            8,
-            pkt->req->getFlags(),
-            pkt->req->requestorId(),
-            false
-            );
-    memBypassPort.sendFunctional(macPkt);
-
-    offset = (macPkt->getAddr() - MAC_START) >> 11 << 8;
-    PacketPtr cntPkt = createPkt(
-            CNT_START + offset,
-            64,
-            macPkt->req->getFlags(),
-            macPkt->req->requestorId(),
-            false
-            );
-    memBypassPort.sendFunctional(cntPkt);
-
-    pkt = cntPkt;
-    offset = (pkt->getAddr() - CNT_START) >> 11 << 8;
-    pkt = createPkt(
-            MT_START + offset,
-            64,
-            pkt->req->getFlags(),
-            pkt->req->requestorId(),
-            false
-            );
-    memSidePort.sendFunctional(pkt);
-
-    Addr layer_start = MT_START;
-    Addr layer_size = 0x10000000 >> 3;
-    for (int i=0; i<10; i++) {
-        if (layer_start == RT_START) {
-            // Root
-            break;
-        }
-
-        if (pkt->getAddr() < layer_start+layer_size) {
-            offset = (pkt->getAddr() - layer_start) >> 11 << 8;
-            pkt = createPkt(
-                    layer_start + layer_size + offset,
-                    64,
-                    pkt->req->getFlags(),
-                    pkt->req->requestorId(),
-                    false
-                    );
-            memSidePort.sendFunctional(pkt);
-        }
-        layer_start += layer_size;
-        layer_size >>= 3;
-    }
-
-    return;
+    updateLevels
+        .init(16)
+        .flags(statistics::nozero);
 }
 
 Port &
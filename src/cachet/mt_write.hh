@@ -1,12 +1,26 @@
 #ifndef __CACHET_MT_WRITE_HH__
 #define __CACHET_MT_WRITE_HH__
 
+#include <deque>
+#include <vector>
+
 #include "cachet/base_ctrl.hh"
+#include "cachet/persist_tracker.hh"
+#include "cachet/split_counters.hh"
 #include "params/MTWrite.hh"
 
 namespace gem5
 {
 
+/**
+ * Merkle tree updater. It takes one update at a time: each tree level
+ * is hashed over the new value of the level below, and every update
+ * ends in the root, so two updates would serialize on their common
+ * ancestors anyway. A request arriving during an update is refused and
+ * retried once it completes. With a dirty buffer, the update only
+ * writes the counter and the tree levels are propagated later, which
+ * shortens that window.
+ */
 class MTWrite : public BaseCtrl
 {
   public:
@@ -15,16 +29,78 @@ class MTWrite : public BaseCtrl
     virtual void processNextMTOperation();
     EventFunctionWrapper nextMTOperation;
 
+    void processFlushOperation();
+    EventFunctionWrapper flushOperation;
+
     void processFinishOperation() override;
     bool handleRequest(PacketPtr pkt) override;
     virtual bool handleResponse(PacketPtr pkt) override;
     Tick handleAtomic(PacketPtr pkt) override;
-    void handleFunctional(PacketPtr pkt) override;
+    bool isIdle() const override;
+    bool
+    holdsData(Addr block_addr) const override
+    {
+        return counters.holds(block_addr);
+    }
+    DrainState drain() override;
+
+    void serialize(CheckpointOut &cp) const override;
+    void unserialize(CheckpointIn &cp) override;
 
     MemSidePort memBypassPort;
 
     PacketPtr requestPkt;
     PacketPtr responsePkt;
+    /** Tree levels written so far by the current update */
+    unsigned updateLevels;
+
+    /** Minor counters and their re-encryption, in split-counter mode */
+    SplitCounters counters;
+    /** Persist ordering and shadow tracking, with an NVM backing */
+    PersistTracker persist;
+
+    /**
+     * Lazy update mode. A write only updates its counter, which is then
+     * kept in the dirty buffer. Once the buffer is full, all buffered
+     * nodes are propagated to the root together, level by level, so an
+     * ancestor shared by several writes is rehashed once per batch.
+     */
+    const unsigned dirtyBufferEntries;
+    /** Counters whose update still has to reach the root, oldest first */
+    std::deque<Addr> dirtyNodes;
+    bool flushing;
+    /** Nodes of the level currently being written by the flush */
+    std::vector<Addr> flushNodes;
+    /** Nodes of the flushed level that still need their parent updated */
+    std::vector<Addr> nextFlushNodes;
+    unsigned flushOutstanding;
+    RequestorID flushRequestorId;
+
+    bool lazyUpdate() const { return dirtyBufferEntries > 0; }
+    /**
+     * Handle the responses that do not belong to an eager update: MAC
+     * writes, flush writes and counter writes of a lazy update.
+     * @return true if the packet was consumed.
+     */
+    bool handleDeferredResponse(PacketPtr pkt);
+    void markDirty(Addr addr);
+    void startFlush();
+    void flushNextLevel();
+    void handleFlushResponse(PacketPtr pkt);
+    /** Whether the flush can stop propagating above this node */
+    virtual bool stopsFlush(PacketPtr pkt) { return false; }
+
+    struct MTWriteStats : public statistics::Group
+    {
+        MTWriteStats(MTWrite &ctrl);
+
+        statistics::Scalar bypassPkts;
+        statistics::Scalar bypassBytes;
+        statistics::Histogram updateLevels;
+        statistics::Scalar coalescedUpdates;
+        statistics::Scalar flushes;
+        statistics::Scalar flushedNodes;
+    } mtStats;
 
     MTWrite(const MTWriteParams &p);
     Port& getPort(const std::string &if_name,
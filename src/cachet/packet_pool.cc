@@ -0,0 +1,80 @@
+#include "cachet/packet_pool.hh"
+
+#include "base/logging.hh"
+
+namespace gem5
+{
+
+ChunkArena::~ChunkArena()
+{
+    for (auto chunk : freeChunks) {
+        ::operator delete(chunk);
+    }
+}
+
+void *
+ChunkArena::allocate(size_t size)
+{
+    if (chunkSize == 0) {
+        chunkSize = size;
+    }
+    panic_if(size != chunkSize, "Arena of %d byte chunks asked for %d",
+            chunkSize, size);
+
+    if (freeChunks.empty()) {
+        return ::operator new(chunkSize);
+    }
+
+    void *chunk = freeChunks.back();
+    freeChunks.pop_back();
+    return chunk;
+}
+
+void
+ChunkArena::deallocate(void *chunk)
+{
+    freeChunks.push_back(chunk);
+}
+
+PacketPool::PacketPool(unsigned buffer_size) :
+    bufferSize(buffer_size),
+    requestArena(std::make_shared<ChunkArena>())
+{
+}
+
+PacketPtr
+PacketPool::allocate(Addr addr, unsigned size, Request::Flags flags,
+                     RequestorID id, MemCmd cmd)
+{
+    panic_if(size > bufferSize, "Packet of %d bytes does not fit the %d "
+            "byte pool buffers", size, bufferSize);
+
+    Slot *slot;
+    if (freeSlots.empty()) {
+        slots.emplace_back(new Slot);
+        slot = slots.back().get();
+        slot->data.reset(new uint8_t[bufferSize]);
+    } else {
+        slot = freeSlots.back();
+        freeSlots.pop_back();
+    }
+
+    RequestPtr req = std::allocate_shared<Request>(
+            ArenaAllocator<Request>(requestArena), addr, size, flags, id);
+    PacketPtr pkt = new (slot->pkt) Packet(req, cmd);
+    pkt->dataStatic(slot->data.get());
+
+    return pkt;
+}
+
+void
+PacketPool::release(PacketPtr pkt)
+{
+    static_assert(offsetof(Slot, pkt) == 0,
+            "The packet must sit at the start of its slot");
+
+    pkt->~Packet();
+    freeSlots.push_back(reinterpret_cast<Slot *>(pkt));
+}
+
+} // namespace gem5
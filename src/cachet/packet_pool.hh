@@ -0,0 +1,111 @@
+#ifndef __CACHET_PACKET_POOL_HH__
+#define __CACHET_PACKET_POOL_HH__
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "mem/packet.hh"
+#include "mem/request.hh"
+
+namespace gem5
+{
+
+/**
+ * Free-list arena handing out chunks of a single size. Chunks are never
+ * returned to the heap until the arena itself goes away.
+ */
+class ChunkArena
+{
+  private:
+    size_t chunkSize;
+    std::vector<void *> freeChunks;
+
+  public:
+    ChunkArena() : chunkSize(0) {}
+    ~ChunkArena();
+
+    void *allocate(size_t size);
+    void deallocate(void *chunk);
+};
+
+/**
+ * Allocator drawing from a ChunkArena, used to pool the requests (and
+ * their shared pointer control blocks) through std::allocate_shared.
+ * Every copy keeps the arena alive, so requests still referenced by
+ * another object after their packet was released stay valid.
+ */
+template <class T>
+class ArenaAllocator
+{
+  public:
+    typedef T value_type;
+
+    std::shared_ptr<ChunkArena> arena;
+
+    ArenaAllocator(std::shared_ptr<ChunkArena> _arena) : arena(_arena) {}
+
+    template <class U>
+    ArenaAllocator(const ArenaAllocator<U> &other) : arena(other.arena) {}
+
+    T *
+    allocate(size_t n)
+    {
+        assert(n == 1);
+        return static_cast<T *>(arena->allocate(sizeof(T)));
+    }
+
+    void deallocate(T *p, size_t n) { arena->deallocate(p); }
+
+    template <class U>
+    bool
+    operator==(const ArenaAllocator<U> &other) const
+    {
+        return arena == other.arena;
+    }
+
+    template <class U>
+    bool
+    operator!=(const ArenaAllocator<U> &other) const
+    {
+        return arena != other.arena;
+    }
+};
+
+/**
+ * Pool of the packets, requests and data buffers a controller generates
+ * for its metadata accesses. Packets are recycled through release() once
+ * their response came back, which keeps long runs from growing the heap
+ * and avoids hitting malloc on every metadata access.
+ */
+class PacketPool
+{
+  private:
+    /** Storage for one packet and its data buffer */
+    struct Slot
+    {
+        alignas(Packet) unsigned char pkt[sizeof(Packet)];
+        std::unique_ptr<uint8_t[]> data;
+    };
+
+    const unsigned bufferSize;
+
+    std::vector<std::unique_ptr<Slot>> slots;
+    std::vector<Slot *> freeSlots;
+    std::shared_ptr<ChunkArena> requestArena;
+
+  public:
+    PacketPool(unsigned buffer_size);
+
+    PacketPtr allocate(Addr addr, unsigned size, Request::Flags flags,
+                       RequestorID id, MemCmd cmd);
+    void release(PacketPtr pkt);
+
+    /** Number of packets allocated so far, in use or free */
+    size_t capacity() const { return slots.size(); }
+    size_t inUse() const { return slots.size() - freeSlots.size(); }
+};
+
+} // namespace gem5
+
+#endif // __CACHET_PACKET_POOL_HH__
@@ -0,0 +1,241 @@
+#include "cachet/persist_tracker.hh"
+
+#include "base/trace.hh"
+#include "debug/PersistTracker.hh"
+
+namespace gem5
+{
+
+PersistTracker::PersistTracker(BaseCtrl &_ctrl,
+                               BaseCtrl::MemSidePort &_port,
+                               PersistMode _mode, Tick root_latency,
+                               Tick recovery_block_time) :
+    ctrl(_ctrl),
+    layout(_ctrl.layout),
+    port(_port),
+    mode(_mode),
+    rootLatency(root_latency),
+    recoveryBlockTime(recovery_block_time),
+    trackedNodes(0),
+    barrierStart(MaxTick),
+    stats(*this)
+{
+    if (mode == PersistMode::shadow) {
+        fatal_if(layout->getShadowEntries() == 0, "%s: shadow tracking "
+                "needs a shadow table in the layout", ctrl.name());
+        shadowTable.assign(layout->getShadowEntries(), MaxAddr);
+    }
+    if (enabled()) {
+        recoveryStats.reset(new RecoveryStats(*this));
+    }
+}
+
+void
+PersistTracker::sendPersist(Addr addr, unsigned size,
+                            RequestorID requestor_id)
+{
+    PacketPtr pkt = ctrl.createPkt(addr, size, 0, requestor_id, false);
+    watch(pkt);
+    port.sendPacket(pkt);
+}
+
+void
+PersistTracker::watch(PacketPtr pkt)
+{
+    if (!enabled()) {
+        return;
+    }
+    stats.persistWrites++;
+    stats.persistBytes += pkt->getSize();
+    persistPkts.insert(pkt);
+}
+
+void
+PersistTracker::nodeUpdated(PacketPtr pkt)
+{
+    Addr node = pkt->getAddr();
+    // The root is persisted in its own register
+    if (!enabled() || layout->isRoot(node)) {
+        return;
+    }
+
+    RequestorID requestor_id = pkt->req->requestorId();
+    if (mode == PersistMode::strict) {
+        stats.writeThroughs++;
+        sendPersist(node, layout->getBlockSize(), requestor_id);
+        return;
+    }
+
+    unsigned entry = (layout->toLocal(node) / layout->getBlockSize()) %
+        shadowTable.size();
+    Addr &tracked = shadowTable[entry];
+    if (tracked == node) {
+        return;
+    }
+
+    if (tracked != MaxAddr) {
+        // The node loses its entry, it has to be persisted before the
+        // table stops covering it
+        DPRINTF(PersistTracker, "Shadow entry %d moves from %#x to %#x\n",
+                entry, tracked, node);
+        stats.shadowReplacements++;
+        stats.writeThroughs++;
+        sendPersist(tracked, layout->getBlockSize(), requestor_id);
+    } else {
+        trackedNodes++;
+    }
+    tracked = node;
+
+    stats.shadowWrites++;
+    sendPersist(layout->shadowAddr(entry), IntegrityLayout::shadowEntrySize,
+                requestor_id);
+}
+
+Tick
+PersistTracker::persistRoot()
+{
+    if (!enabled()) {
+        return 0;
+    }
+    stats.rootPersists++;
+    return rootLatency;
+}
+
+void
+PersistTracker::startBarrier()
+{
+    assert(busy() && barrierStart == MaxTick);
+    DPRINTF(PersistTracker, "Wait for %d persists\n", persistPkts.size());
+    barrierStart = curTick();
+    stats.barriers++;
+}
+
+bool
+PersistTracker::endBarrier()
+{
+    if (barrierStart == MaxTick) {
+        return false;
+    }
+    stats.barrierTicks += curTick() - barrierStart;
+    barrierStart = MaxTick;
+    return true;
+}
+
+bool
+PersistTracker::handleResponse(PacketPtr pkt)
+{
+    auto it = persistPkts.find(pkt);
+    if (it == persistPkts.end()) {
+        return false;
+    }
+    persistPkts.erase(it);
+    ctrl.destroyPkt(pkt);
+    return true;
+}
+
+uint64_t
+PersistTracker::recoveryReads() const
+{
+    const unsigned root = layout->numLevels() - 1;
+    // Checking the root reads the nodes right below it
+    uint64_t reads = layout->levelSize(root - 1) / layout->getBlockSize();
+
+    if (mode == PersistMode::none) {
+        // Every level below the root is read to rebuild the one above
+        for (unsigned level = 0; level + 1 < root; level++) {
+            reads += layout->levelSize(level) / layout->getBlockSize();
+        }
+    } else if (mode == PersistMode::shadow) {
+        reads += layout->shadowBlocks() + trackedNodes * layout->arity(1);
+    }
+    return reads;
+}
+
+uint64_t
+PersistTracker::recoveryHashes() const
+{
+    uint64_t hashes = 1;
+    if (mode == PersistMode::none) {
+        const unsigned root = layout->numLevels() - 1;
+        for (unsigned level = 1; level < root; level++) {
+            hashes += layout->levelSize(level) / layout->getBlockSize();
+        }
+    } else if (mode == PersistMode::shadow) {
+        hashes += trackedNodes;
+    }
+    return hashes;
+}
+
+void
+PersistTracker::serialize(CheckpointOut &cp) const
+{
+    assert(!busy());
+    SERIALIZE_CONTAINER(shadowTable);
+}
+
+void
+PersistTracker::unserialize(CheckpointIn &cp)
+{
+    std::vector<Addr> shadow_table;
+    UNSERIALIZE_CONTAINER(shadow_table);
+    fatal_if(shadow_table.size() != shadowTable.size(),
+            "%s: the checkpoint has a shadow table of %d entries",
+            ctrl.name(), shadow_table.size());
+
+    shadowTable = shadow_table;
+    trackedNodes = 0;
+    for (auto node : shadowTable) {
+        trackedNodes += node != MaxAddr;
+    }
+}
+
+PersistTracker::PersistTrackerStats::PersistTrackerStats(
+        PersistTracker &tracker) :
+    statistics::Group(&tracker.ctrl, "persistTracker"),
+    ADD_STAT(persistWrites, statistics::units::Count::get(),
+             "Writes an update had to persist before its acknowledgement"),
+    ADD_STAT(persistBytes, statistics::units::Byte::get(),
+             "Bytes of the persist writes"),
+    ADD_STAT(writeThroughs, statistics::units::Count::get(),
+             "Tree nodes written through to memory"),
+    ADD_STAT(shadowWrites, statistics::units::Count::get(),
+             "Shadow table entries written"),
+    ADD_STAT(shadowReplacements, statistics::units::Count::get(),
+             "Shadow table entries reused by another node"),
+    ADD_STAT(rootPersists, statistics::units::Count::get(),
+             "Root updates persisted in the root register"),
+    ADD_STAT(barriers, statistics::units::Count::get(),
+             "Updates that waited for their persists"),
+    ADD_STAT(barrierTicks, statistics::units::Tick::get(),
+             "Ticks the updates waited for their persists"),
+    ADD_STAT(avgBarrierTicks, statistics::units::Rate<
+                statistics::units::Tick, statistics::units::Count>::get(),
+             "Average ticks an update waited for its persists"),
+    ADD_STAT(trackedNodes, statistics::units::Count::get(),
+             "Tree nodes tracked in the shadow table")
+{
+    avgBarrierTicks = barrierTicks / barriers;
+
+    trackedNodes.functor([&tracker] { return tracker.trackedNodes; });
+}
+
+PersistTracker::RecoveryStats::RecoveryStats(PersistTracker &tracker) :
+    statistics::Group(&tracker.stats),
+    ADD_STAT(recoveryReads, statistics::units::Count::get(),
+             "Metadata blocks a recovery would read"),
+    ADD_STAT(recoveryHashes, statistics::units::Count::get(),
+             "Tree nodes a recovery would rehash"),
+    ADD_STAT(recoveryTicks, statistics::units::Tick::get(),
+             "Estimated recovery time after a crash")
+{
+    recoveryReads.functor([&tracker] { return tracker.recoveryReads(); });
+    recoveryHashes.functor([&tracker] {
+        return tracker.recoveryHashes();
+    });
+    recoveryTicks.functor([&tracker] {
+        return tracker.recoveryReads() * tracker.recoveryBlockTime +
+            tracker.ctrl.hashEngine->batchLatency(tracker.recoveryHashes());
+    });
+}
+
+} // namespace gem5
@@ -0,0 +1,137 @@
+#ifndef __CACHET_PERSIST_TRACKER_HH__
+#define __CACHET_PERSIST_TRACKER_HH__
+
+#include <memory>
+#include <unordered_set>
+#include <vector>
+
+#include "base/statistics.hh"
+#include "cachet/base_ctrl.hh"
+#include "enums/PersistMode.hh"
+#include "sim/serialize.hh"
+
+namespace gem5
+{
+
+/**
+ * Crash consistency of the tree of a write controller backed by NVM.
+ *
+ * The MACs and counters are written straight to memory, the tree nodes
+ * are only updated in the volatile meta cache and the root lives in an
+ * on-chip non-volatile register. After a crash, the nodes that were dirty
+ * in the meta cache are lost and have to be rebuilt from their children
+ * before the root can be checked. The persist mode decides what an update
+ * waits for and what the recovery has to rebuild:
+ *  - none: nothing is ordered, the whole tree is rebuilt.
+ *  - strict: every updated node is written through to memory, only the
+ *    root is checked.
+ *  - shadow: the address of every node becoming dirty in the meta cache
+ *    is persisted in a shadow table, and only the tracked nodes are
+ *    rebuilt.
+ * In the last two modes a write is only acknowledged once its MAC, its
+ * write-throughs and its shadow entries are persisted, and every root
+ * update is a persist barrier of its own.
+ *
+ * The shadow table is direct mapped. The tracker does not see the
+ * write-backs of the meta cache, so a node stays tracked until its entry
+ * is reused, and the node it held is then written through as it is no
+ * longer covered. The recovery estimate is thus an upper bound.
+ */
+class PersistTracker : public Serializable
+{
+  private:
+    BaseCtrl &ctrl;
+    IntegrityLayout *layout;
+    /** Port the persist writes are sent through, straight to memory */
+    BaseCtrl::MemSidePort &port;
+
+    const PersistMode mode;
+    /** Latency of a root update in its non-volatile register */
+    const Tick rootLatency;
+    /** Average time to read one metadata block during the recovery */
+    const Tick recoveryBlockTime;
+
+    /** Tree node tracked by every shadow table entry, MaxAddr if none */
+    std::vector<Addr> shadowTable;
+    uint64_t trackedNodes;
+
+    /** Persist writes still in flight */
+    std::unordered_set<PacketPtr> persistPkts;
+    /** Tick at which an update started waiting for its persists */
+    Tick barrierStart;
+
+    void sendPersist(Addr addr, unsigned size, RequestorID requestor_id);
+
+    /** Metadata blocks read by a recovery from the current state */
+    uint64_t recoveryReads() const;
+    /** Tree nodes rehashed by a recovery, the root check included */
+    uint64_t recoveryHashes() const;
+
+    struct PersistTrackerStats : public statistics::Group
+    {
+        PersistTrackerStats(PersistTracker &tracker);
+
+        statistics::Scalar persistWrites;
+        statistics::Scalar persistBytes;
+        statistics::Scalar writeThroughs;
+        statistics::Scalar shadowWrites;
+        statistics::Scalar shadowReplacements;
+        statistics::Scalar rootPersists;
+        statistics::Scalar barriers;
+        statistics::Scalar barrierTicks;
+        statistics::Formula avgBarrierTicks;
+
+        statistics::Value trackedNodes;
+    } stats;
+
+    /** Recovery estimates, only registered when persisting */
+    struct RecoveryStats : public statistics::Group
+    {
+        RecoveryStats(PersistTracker &tracker);
+
+        statistics::Value recoveryReads;
+        statistics::Value recoveryHashes;
+        statistics::Value recoveryTicks;
+    };
+    std::unique_ptr<RecoveryStats> recoveryStats;
+
+  public:
+    PersistTracker(BaseCtrl &ctrl, BaseCtrl::MemSidePort &port,
+                   PersistMode mode, Tick root_latency,
+                   Tick recovery_block_time);
+
+    /** Whether updates are ordered with their persists */
+    bool enabled() const { return mode != PersistMode::none; }
+    /** Whether persist writes are still in flight */
+    bool busy() const { return !persistPkts.empty(); }
+
+    /** Make the current update wait for a write sent by the owner */
+    void watch(PacketPtr pkt);
+    /**
+     * Account for a tree node written in the meta cache by an update,
+     * writing it through or tracking it in the shadow table.
+     */
+    void nodeUpdated(PacketPtr pkt);
+    /** Persist a root update, @return the latency of the barrier */
+    Tick persistRoot();
+
+    /** Hold the acknowledgement of an update until busy() is false */
+    void startBarrier();
+    /**
+     * Release the update waiting for its persists, if any.
+     * @return true if one was waiting.
+     */
+    bool endBarrier();
+    /**
+     * Handle the response of a persist write.
+     * @return true if the packet was a persist write.
+     */
+    bool handleResponse(PacketPtr pkt);
+
+    void serialize(CheckpointOut &cp) const override;
+    void unserialize(CheckpointIn &cp) override;
+};
+
+} // namespace gem5
+
+#endif // __CACHET_PERSIST_TRACKER_HH__
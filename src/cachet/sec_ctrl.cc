@@ -1,5 +1,8 @@
 #include "cachet/sec_ctrl.hh"
 
+#include <algorithm>
+
+#include "base/intmath.hh"
 #include "base/trace.hh"
 #include "debug/SecCtrl.hh"
 
@@ -10,40 +13,112 @@ SecCtrl::SecCtrl(const SecCtrlParams &p) :
     BaseCtrl(p),
     readPort(name() + ".read_port", this),
     writePort(name() + ".write_port", this),
-    state(Idle),
-    requestPkt(nullptr),
-    needsResponse(false),
-    responsePkt(nullptr),
-    readFinished(false),
-    writeFinished(false)
+    blockSize(p.block_size),
+    prefetcher(p.prefetcher),
+    aesEngine(p.aes_engine),
+    writeCtrl(p.write_ctrl),
+    transactions(p.transaction_entries),
+    speculative(p.speculative),
+    verificationWindow(p.verification_window),
+    nextSpecSeq(0),
+    padEvent([this]{ processPadQueue(); }, name() + ".padEvent"),
+    writeBufferEntries(p.write_buffer_entries),
+    writeHighWatermark(p.write_high_watermark),
+    writeLowWatermark(p.write_low_watermark),
+    bufferLatency(p.buffer_latency),
+    flushingWrites(false),
+    bufferResponseEvent([this]{ processBufferResponses(); },
+            name() + ".bufferResponseEvent"),
+    faultAddr(p.fault_addr),
+    faultTick(p.fault_tick),
+    faultEvent([this]{ checker->injectFault(faultAddr); },
+            name() + ".faultEvent"),
+    protectedRanges(p.protected_ranges),
+    secStats(*this)
 {
     DPRINTF(SecCtrl, "Constructing\n");
+    fatal_if(transactions.empty(), "%s needs at least one transaction "
+            "table entry", name());
+    fatal_if(writeBufferEntries && (writeHighWatermark > writeBufferEntries ||
+                writeLowWatermark >= writeHighWatermark),
+            "%s: the write buffer watermarks must satisfy low < high <= "
+            "entries", name());
+    fatal_if(faultAddr != MaxAddr && !p.verify_data, "%s: fault injection "
+            "needs verify_data", name());
+    for (const auto &range : protectedRanges) {
+        fatal_if(!layout->isData(range.end() - 1), "%s: protected range %s "
+                "lies past the protected data", name(), range.to_string());
+        fatal_if(!range.interleaved() && (range.start() % blockSize ||
+                    range.end() % blockSize), "%s: protected range %s "
+                "must cover whole blocks", name(), range.to_string());
+    }
+
+    if (writeCtrl) {
+        writeCtrl->dataReleased = [this]{ releaseHeldWrites(); };
+        writeCtrl->sendData = [this](PacketPtr pkt) {
+            writeCtrlPkts.insert(pkt);
+            memSidePort.sendPacket(pkt);
+        };
+    }
+
+    if (p.verify_data) {
+        checker.reset(new IntegrityChecker(*this, memSidePort, p.mac_key,
+                    p.halt_on_violation));
+    }
 }
 
 void
-SecCtrl::processFinishOperation()
+SecCtrl::startup()
 {
-    DPRINTF(SecCtrl, "finish process\n");
-    if (responsePkt) {
-        cpuSidePort.sendPacket(responsePkt);
-    }
-    state = Idle;
-    requestPkt = nullptr;
-    needsResponse = false;
-    responsePkt = nullptr;
-    readFinished = false;
-    writeFinished = false;
-    cpuSidePort.trySendRetry();
+    if (faultAddr != MaxAddr) {
+        schedule(faultEvent, std::max(curTick(), faultTick));
+    }
+}
+
+void
+SecCtrl::serialize(CheckpointOut &cp) const
+{
+    if (checker) {
+        checker->serializeSection(cp, "integrityChecker");
+    }
+}
+
+void
+SecCtrl::unserialize(CheckpointIn &cp)
+{
+    if (checker) {
+        checker->unserializeSection(cp, "integrityChecker");
+    }
+}
+
+SecCtrl::Transaction *
+SecCtrl::allocateTransaction()
+{
+    for (auto &txn : transactions) {
+        if (txn.state == Idle) {
+            return &txn;
+        }
+    }
+    return nullptr;
 }
 
 bool
-SecCtrl::handleRequest(PacketPtr pkt)
+SecCtrl::isBlockInFlight(Addr block_addr) const
 {
-    if (state != Idle) {
-        return false;
+    for (const auto &txn : transactions) {
+        if (txn.state != Idle && txn.blockAddr == block_addr) {
+            return true;
+        }
     }
+    return false;
+}
 
-    DPRINTF(SecCtrl, "Got request for %#x\n", pkt->print());
+void
+SecCtrl::startTransaction(Transaction *txn)
+{
+    PacketPtr pkt = txn->requestPkt;
+    DPRINTF(SecCtrl, "Start transaction for %#x\n", pkt->print());
+    txn->startTick = curTick();
 
     PacketPtr readPkt = createPkt(
             pkt->getAddr(),
@@ -52,89 +127,626 @@ SecCtrl::handleRequest(PacketPtr pkt)
             pkt->req->requestorId(),
             true
             );
-    switch (state) {
-        case Idle:
-            requestPkt = pkt;
-            needsResponse = pkt->needsResponse();
-            readPort.sendPacket(readPkt);
-            if (pkt->isRead()) {
-                state = Read;
-                memSidePort.sendPacket(pkt);
-            } else {
-                state = Write;
+    if (aesEngine && pkt->isRead()) {
+        readPkt->pushSenderState(new CounterReadyState(
+                    [this, txn]{ counterReady(txn); }));
+    }
+    outstandingPkts[readPkt] = txn;
+    readPort.sendPacket(readPkt);
+    if (pkt->isRead()) {
+        txn->state = Read;
+        if (txn->needsResponse) {
+            outstandingPkts[pkt] = txn;
+        }
+        memSidePort.sendPacket(pkt);
+    } else {
+        txn->state = Write;
+    }
+}
+
+void
+SecCtrl::counterReady(Transaction *txn)
+{
+    assert(txn->state == Read && txn->padTick == MaxTick);
+    txn->padTick = aesEngine->reserve();
+    DPRINTF(SecCtrl, "Pad of %#x ready at %d\n", txn->blockAddr,
+            txn->padTick);
+    secStats.padLatency.sample(txn->padTick - txn->startTick);
+
+    // Data that arrived first is forwarded once it can be decrypted
+    if (speculative && txn->responsePkt && !txn->readFinished) {
+        forwardData(txn);
+    }
+}
+
+void
+SecCtrl::processPadQueue()
+{
+    while (!padQueue.empty() && padQueue.begin()->first <= curTick()) {
+        Transaction *txn = padQueue.begin()->second;
+        padQueue.erase(padQueue.begin());
+        if (txn->state == Read && txn->responsePkt && !txn->forwarded &&
+                !txn->readFinished && txn->padTick <= curTick()) {
+            forwardData(txn);
+        }
+    }
+    if (!padQueue.empty()) {
+        schedule(padEvent, padQueue.begin()->first);
+    }
+    checkDrain();
+}
+
+void
+SecCtrl::scheduleFinish(Transaction *txn, Tick when)
+{
+    finishQueue.emplace(when, txn);
+    if (!finishOperation.scheduled()) {
+        schedule(finishOperation, when);
+    } else if (when < finishOperation.when()) {
+        reschedule(finishOperation, when);
+    }
+}
+
+void
+SecCtrl::finishTransaction(Transaction *txn)
+{
+    if (txn->forwarded) {
+        secStats.hiddenVerifyTicks += curTick() - txn->dataTick;
+        unverifiedReads.erase(txn->specSeq);
+    } else if (txn->responsePkt && txn->posted) {
+        // The write was acknowledged when it entered the write buffer
+        delete txn->responsePkt;
+    } else if (txn->responsePkt) {
+        if (txn->state == Read) {
+            secStats.exposedVerifyTicks += curTick() - txn->dataTick;
+        }
+        cpuSidePort.sendPacket(txn->responsePkt);
+    }
+
+    if (txn->state == Read) {
+        secStats.readLatency.sample(curTick() - txn->entryTick);
+        if (aesEngine && txn->dataTick != MaxTick) {
+            secStats.padReads++;
+            if (txn->padTick > txn->dataTick) {
+                secStats.lateCounterReads++;
+                secStats.exposedPadTicks += txn->padTick - txn->dataTick;
             }
+        }
+    } else {
+        secStats.writeLatency.sample(curTick() - txn->entryTick);
+    }
+
+    Addr block_addr = txn->blockAddr;
+    txn->clear();
+
+    // Same-address accesses are kept in order, so wake up the oldest
+    // transaction waiting for this block
+    for (auto it = blockedTransactions.begin();
+            it != blockedTransactions.end(); it++) {
+        if ((*it)->blockAddr == block_addr) {
+            Transaction *next = *it;
+            blockedTransactions.erase(it);
+            startTransaction(next);
             break;
+        }
+    }
 
-        default:
-            assert(false);
+    if (speculative) {
+        updateSpeculation();
     }
+    drainWriteBuffer();
+}
 
-    return true;
+void
+SecCtrl::forwardData(Transaction *txn)
+{
+    if (aesEngine && txn->padTick > curTick()) {
+        // Nothing to forward before the data can be decrypted
+        auto range = padQueue.equal_range(txn->padTick);
+        bool queued = std::any_of(range.first, range.second,
+                [txn](const auto &entry) { return entry.second == txn; });
+        if (txn->padTick != MaxTick && !queued) {
+            padQueue.emplace(txn->padTick, txn);
+            if (!padEvent.scheduled()) {
+                schedule(padEvent, txn->padTick);
+            } else if (txn->padTick < padEvent.when()) {
+                reschedule(padEvent, txn->padTick);
+            }
+        }
+        return;
+    }
+
+    if (unverifiedReads.size() >= verificationWindow) {
+        DPRINTF(SecCtrl, "Verification window full, hold %#x\n",
+                txn->blockAddr);
+        // Held reads are retried after every finished transaction
+        if (!txn->windowStalled) {
+            txn->windowStalled = true;
+            secStats.windowStalls++;
+        }
+        return;
+    }
+
+    DPRINTF(SecCtrl, "Forward unverified data of %#x\n", txn->blockAddr);
+    secStats.specForwards++;
+    txn->forwarded = true;
+    txn->specSeq = nextSpecSeq++;
+    unverifiedReads.insert(txn->specSeq);
+    cpuSidePort.sendPacket(txn->responsePkt);
+    txn->responsePkt = nullptr;
 }
 
-bool
-SecCtrl::handleResponse(PacketPtr pkt)
+void
+SecCtrl::sendWrite(Transaction *txn)
 {
-    assert(state != Idle);
-    DPRINTF(SecCtrl, "Got response for %#x\n", pkt->print());
+    // The written value may depend on unverified reads, so it stays on
+    // chip until the reads forwarded before it are verified
+    if (!unverifiedReads.empty() && *unverifiedReads.begin() < txn->fenceSeq) {
+        if (txn->fenceTick == MaxTick) {
+            DPRINTF(SecCtrl, "Fence write of %#x\n", txn->blockAddr);
+            secStats.writeFences++;
+            txn->fenceTick = curTick();
+            fencedWrites.push_back(txn);
+        }
+        return;
+    }
+
+    if (txn->fenceTick != MaxTick) {
+        secStats.fenceTicks += curTick() - txn->fenceTick;
+        txn->fenceTick = MaxTick;
+    }
+
+    if (writeCtrl && writeCtrl->holdsData(txn->blockAddr)) {
+        DPRINTF(SecCtrl, "Hold write of %#x\n", txn->blockAddr);
+        secStats.heldWrites++;
+        heldWrites.push_back(txn);
+        return;
+    }
 
     PacketPtr writePkt = createPkt(
-            requestPkt->getAddr(),
+            txn->requestPkt->getAddr(),
             1,
-            requestPkt->req->getFlags(),
-            requestPkt->req->requestorId(),
+            txn->requestPkt->req->getFlags(),
+            txn->requestPkt->req->requestorId(),
             false
             );
-    switch (state) {
+    if (checker) {
+        checker->update(txn->requestPkt);
+    }
+    if (aesEngine) {
+        // The pad of the new counter encrypts the data, it only takes
+        // its share of the engine as the write is off the critical path
+        aesEngine->reserve();
+    }
+    if (txn->needsResponse) {
+        outstandingPkts[txn->requestPkt] = txn;
+    }
+    outstandingPkts[writePkt] = txn;
+    memSidePort.sendPacket(txn->requestPkt);
+    writePort.sendPacket(writePkt);
+}
+
+void
+SecCtrl::releaseHeldWrites()
+{
+    std::list<Transaction *> released;
+    released.swap(heldWrites);
+    for (auto txn : released) {
+        sendWrite(txn);
+    }
+}
+
+void
+SecCtrl::updateSpeculation()
+{
+    for (auto &txn : transactions) {
+        if (txn.state == Read && txn.responsePkt && !txn.readFinished) {
+            forwardData(&txn);
+        }
+    }
+
+    for (auto it = fencedWrites.begin(); it != fencedWrites.end();) {
+        Transaction *txn = *it;
+        if (!unverifiedReads.empty() &&
+                *unverifiedReads.begin() < txn->fenceSeq) {
+            it++;
+            continue;
+        }
+        it = fencedWrites.erase(it);
+        sendWrite(txn);
+    }
+}
+
+bool
+SecCtrl::isBlockBuffered(Addr block_addr) const
+{
+    for (const auto &write : writeBuffer) {
+        if (write.blockAddr == block_addr) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void
+SecCtrl::respondFromBuffer(PacketPtr pkt)
+{
+    Tick when = curTick() + bufferLatency;
+    bufferResponses.emplace_back(when, pkt);
+    if (!bufferResponseEvent.scheduled()) {
+        schedule(bufferResponseEvent, when);
+    }
+}
+
+void
+SecCtrl::processBufferResponses()
+{
+    while (!bufferResponses.empty() &&
+            bufferResponses.front().first <= curTick()) {
+        cpuSidePort.sendPacket(bufferResponses.front().second);
+        bufferResponses.pop_front();
+    }
+    if (!bufferResponses.empty()) {
+        schedule(bufferResponseEvent, bufferResponses.front().first);
+    }
+    checkDrain();
+}
+
+bool
+SecCtrl::postWrite(PacketPtr pkt)
+{
+    Addr block_addr = pkt->getBlockAddr(blockSize);
+
+    // A write covering the last buffered write of its block replaces it
+    BufferedWrite *last = nullptr;
+    for (auto it = writeBuffer.rbegin(); it != writeBuffer.rend(); it++) {
+        if (it->blockAddr == block_addr) {
+            last = &*it;
+            break;
+        }
+    }
+    bool coalesce = last && !last->urgent &&
+        pkt->getAddr() <= last->pkt->getAddr() &&
+        pkt->getAddr() + pkt->getSize() >=
+            last->pkt->getAddr() + last->pkt->getSize();
+
+    if (!coalesce && writeBuffer.size() >= writeBufferEntries) {
+        secStats.bufferFullStalls++;
+        return false;
+    }
+
+    DPRINTF(SecCtrl, "Post write %s\n", pkt->print());
+    PacketPtr posted = pkt;
+    if (pkt->needsResponse()) {
+        // The requestor gets its response now, memory gets a copy
+        RequestPtr req = std::make_shared<Request>(*pkt->req);
+        posted = new Packet(req, pkt->cmd);
+        posted->allocate();
+        posted->setData(pkt->getConstPtr<uint8_t>());
+        pkt->makeResponse();
+        respondFromBuffer(pkt);
+    }
+
+    secStats.postedWrites++;
+    if (coalesce) {
+        secStats.coalescedWrites++;
+        delete last->pkt;
+        last->pkt = posted;
+    } else {
+        writeBuffer.push_back({posted, block_addr, curTick(), false});
+    }
+    return true;
+}
+
+bool
+SecCtrl::forwardBufferedWrite(PacketPtr pkt)
+{
+    Addr block_addr = pkt->getBlockAddr(blockSize);
+    for (auto it = writeBuffer.rbegin(); it != writeBuffer.rend(); it++) {
+        if (it->blockAddr != block_addr) {
+            continue;
+        }
+
+        // Only the youngest write of the block holds the latest data
+        PacketPtr write = it->pkt;
+        if (write->getAddr() <= pkt->getAddr() &&
+                pkt->getAddr() + pkt->getSize() <=
+                write->getAddr() + write->getSize()) {
+            DPRINTF(SecCtrl, "Serve %s from the write buffer\n",
+                    pkt->print());
+            pkt->setData(write->getConstPtr<uint8_t>() +
+                    (pkt->getAddr() - write->getAddr()));
+            pkt->makeResponse();
+            respondFromBuffer(pkt);
+            return true;
+        }
+        break;
+    }
+
+    // The read goes to memory once the writes of its block are out
+    bool buffered = false;
+    for (auto &write : writeBuffer) {
+        if (write.blockAddr == block_addr && !write.urgent) {
+            write.urgent = true;
+            secStats.urgentWrites++;
+            buffered = true;
+        }
+    }
+    if (buffered) {
+        drainWriteBuffer();
+    }
+    return false;
+}
+
+void
+SecCtrl::drainWriteBuffer()
+{
+    if (writeBuffer.empty()) {
+        return;
+    }
+
+    if (!flushingWrites && writeBuffer.size() >= writeHighWatermark) {
+        DPRINTF(SecCtrl, "Write buffer at the high watermark\n");
+        flushingWrites = true;
+        secStats.watermarkFlushes++;
+    }
+
+    // Writes only go out in the background while no read is waiting
+    bool reads_in_flight = false;
+    for (const auto &txn : transactions) {
+        if (txn.state == Read ||
+                (txn.state == Blocked && txn.requestPkt->isRead())) {
+            reads_in_flight = true;
+            break;
+        }
+    }
+
+    for (auto it = writeBuffer.begin(); it != writeBuffer.end();) {
+        if (flushingWrites && writeBuffer.size() <= writeLowWatermark) {
+            flushingWrites = false;
+        }
+        if (!it->urgent && !flushingWrites && reads_in_flight &&
+                drainState() != DrainState::Draining) {
+            it++;
+            continue;
+        }
+
+        Transaction *txn = allocateTransaction();
+        if (!txn) {
+            break;
+        }
+        BufferedWrite write = *it;
+        it = writeBuffer.erase(it);
+
+        txn->blockAddr = write.blockAddr;
+        txn->requestPkt = write.pkt;
+        txn->needsResponse = write.pkt->needsResponse();
+        txn->posted = true;
+        txn->entryTick = write.entryTick;
+        if (prefetcher) {
+            prefetcher->notify(write.pkt);
+        }
+        if (isBlockInFlight(write.blockAddr)) {
+            secStats.blockedReqs++;
+            txn->state = Blocked;
+            blockedTransactions.push_back(txn);
+        } else {
+            startTransaction(txn);
+        }
+    }
+}
+
+DrainState
+SecCtrl::drain()
+{
+    drainWriteBuffer();
+    return BaseCtrl::drain();
+}
+
+void
+SecCtrl::processFinishOperation()
+{
+    DPRINTF(SecCtrl, "finish process\n");
+    while (!finishQueue.empty() && finishQueue.begin()->first <= curTick()) {
+        Transaction *txn = finishQueue.begin()->second;
+        finishQueue.erase(finishQueue.begin());
+        finishTransaction(txn);
+    }
+    if (!finishQueue.empty()) {
+        schedule(finishOperation, finishQueue.begin()->first);
+    }
+    cpuSidePort.trySendRetry();
+    checkDrain();
+}
+
+bool
+SecCtrl::isIdle() const
+{
+    for (const auto &txn : transactions) {
+        if (txn.state != Idle) {
+            return false;
+        }
+    }
+    return fencedWrites.empty() && heldWrites.empty() && padQueue.empty() &&
+        writeBuffer.empty() && bufferResponses.empty() &&
+        bypassPkts.empty() && writeCtrlPkts.empty() && readPort.isIdle() &&
+        writePort.isIdle() && BaseCtrl::isIdle();
+}
+
+bool
+SecCtrl::isProtected(Addr addr) const
+{
+    if (!layout->isData(addr)) {
+        // Only the addresses past the metadata may bypass, the metadata
+        // itself is never accessed from the CPU side
+        panic_if(addr < layout->metaEnd(), "%s: access to metadata "
+                "address %#x", name(), addr);
+        return false;
+    }
+    if (protectedRanges.empty()) {
+        return true;
+    }
+    for (const auto &range : protectedRanges) {
+        if (range.contains(addr)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void
+SecCtrl::bypass(PacketPtr pkt)
+{
+    DPRINTF(SecCtrl, "Bypass %s\n", pkt->print());
+    secStats.bypassReqs++;
+    secStats.bypassBytes += pkt->getSize();
+    if (pkt->needsResponse()) {
+        bypassPkts.insert(pkt);
+    }
+    memSidePort.sendPacket(pkt);
+}
+
+bool
+SecCtrl::handleRequest(PacketPtr pkt)
+{
+    if (!isProtected(pkt->getAddr())) {
+        bypass(pkt);
+        return true;
+    }
+
+    if (writeBufferEntries > 0) {
+        if (pkt->isWrite()) {
+            if (!postWrite(pkt)) {
+                return false;
+            }
+            secStats.writeReqs++;
+            drainWriteBuffer();
+            return true;
+        }
+        if (forwardBufferedWrite(pkt)) {
+            secStats.readReqs++;
+            secStats.bufferedReads++;
+            return true;
+        }
+        // The writes of the block could not all leave the buffer yet
+        if (isBlockBuffered(pkt->getBlockAddr(blockSize))) {
+            return false;
+        }
+    }
+
+    Transaction *txn = allocateTransaction();
+    if (!txn) {
+        return false;
+    }
+
+    DPRINTF(SecCtrl, "Got request for %#x\n", pkt->print());
+
+    Addr block_addr = pkt->getBlockAddr(blockSize);
+    bool in_flight = isBlockInFlight(block_addr);
+
+    txn->blockAddr = block_addr;
+    txn->requestPkt = pkt;
+    txn->needsResponse = pkt->needsResponse();
+    txn->entryTick = curTick();
+    if (pkt->isRead()) {
+        secStats.readReqs++;
+    } else {
+        secStats.writeReqs++;
+    }
+    if (prefetcher) {
+        prefetcher->notify(pkt);
+    }
+    if (in_flight) {
+        DPRINTF(SecCtrl, "Block %#x in flight, blocking\n", block_addr);
+        secStats.blockedReqs++;
+        txn->state = Blocked;
+        blockedTransactions.push_back(txn);
+    } else {
+        startTransaction(txn);
+    }
+
+    return true;
+}
+
+bool
+SecCtrl::handleResponse(PacketPtr pkt)
+{
+    DPRINTF(SecCtrl, "Got response for %#x\n", pkt->print());
+
+    if (bypassPkts.erase(pkt)) {
+        cpuSidePort.sendPacket(pkt);
+        return true;
+    }
+    if (writeCtrlPkts.erase(pkt)) {
+        return writeCtrl->handleResponse(pkt);
+    }
+
+    auto it = outstandingPkts.find(pkt);
+    assert(it != outstandingPkts.end());
+    Transaction *txn = it->second;
+    outstandingPkts.erase(it);
+
+    switch (txn->state) {
         case Idle:
+        case Blocked:
             assert(false);
 
         case Read:
-            if (pkt->getAddr() >= AT_START) {
-                assert(pkt->isRead());
-                readFinished = true;
+            if (pkt == txn->requestPkt) {
+                if (checker) {
+                    checker->verify(pkt);
+                }
+                txn->responsePkt = pkt;
+                txn->dataTick = curTick();
+                if (speculative && !txn->readFinished) {
+                    forwardData(txn);
+                }
             } else {
-                responsePkt = pkt;
+                assert(pkt->isRead());
+                txn->readFinished = true;
+                secStats.verifyLatency.sample(curTick() - txn->startTick);
+                if (aesEngine) {
+                    delete pkt->popSenderState();
+                }
+                destroyPkt(pkt);
             }
 
-            if (needsResponse) {
-                if (responsePkt && readFinished) {
-                    schedule(
-                            finishOperation,
-                            curTick() + HASH_CYCLE*TICK_PER_CYCLE
-                            );
-                }
-            } else {
-                if (readFinished) {
-                    schedule(
-                            finishOperation,
-                            curTick() + HASH_CYCLE*TICK_PER_CYCLE
-                            );
+            // A forwarded read still finishes once its data is verified,
+            // and any read once its data is decrypted
+            if (txn->readFinished &&
+                    (!txn->needsResponse || txn->dataTick != MaxTick)) {
+                Tick when = reserveHash();
+                if (aesEngine) {
+                    when = std::max(when, txn->padTick);
                 }
+                scheduleFinish(txn, when);
             }
 
             break;
 
         case Write:
-            if (pkt->getAddr() >= AT_START) {
-                if (pkt->isRead()) {
-                    readFinished = true;
-                    memSidePort.sendPacket(requestPkt);
-                    writePort.sendPacket(writePkt);
-                } else {
-                    writeFinished = true;
-                }
+            if (pkt == txn->requestPkt) {
+                txn->responsePkt = pkt;
+            } else if (pkt->isRead()) {
+                txn->readFinished = true;
+                secStats.verifyLatency.sample(curTick() - txn->startTick);
+                destroyPkt(pkt);
+
+                txn->fenceSeq = nextSpecSeq;
+                sendWrite(txn);
             } else {
-                responsePkt = pkt;
+                txn->writeFinished = true;
+                destroyPkt(pkt);
             }
 
-            if (needsResponse) {
-                if (responsePkt && readFinished && writeFinished) {
-                    schedule(finishOperation, curTick());
+            if (txn->needsResponse) {
+                if (txn->responsePkt && txn->readFinished &&
+                        txn->writeFinished) {
+                    scheduleFinish(txn, curTick());
                 }
             } else {
-                if (readFinished && writeFinished) {
-                    schedule(finishOperation, curTick());
+                if (txn->readFinished && txn->writeFinished) {
+                    scheduleFinish(txn, curTick());
                 }
             }
 
@@ -147,6 +759,12 @@ SecCtrl::handleResponse(PacketPtr pkt)
 Tick
 SecCtrl::handleAtomic(PacketPtr pkt)
 {
+    if (!isProtected(pkt->getAddr())) {
+        secStats.bypassReqs++;
+        secStats.bypassBytes += pkt->getSize();
+        return memSidePort.sendAtomic(pkt);
+    }
+
     PacketPtr readPkt = createPkt(
             pkt->getAddr(),
             1,
@@ -154,48 +772,167 @@ SecCtrl::handleAtomic(PacketPtr pkt)
             pkt->req->requestorId(),
             true
             );
-    if (!readPort.sendAtomic(readPkt)) {
-        return false;
-    }
-    if (!pkt->isRead()) {
-        PacketPtr writePkt = createPkt(
-                pkt->getAddr(),
-                1,
-                pkt->req->getFlags(),
-                pkt->req->requestorId(),
-                false
-                );
-        if (!writePort.sendAtomic(writePkt)) {
-            return false;
+    Tick verify_latency = readPort.sendAtomic(readPkt);
+    destroyPkt(readPkt);
+
+    if (pkt->isRead()) {
+        // The data is fetched while the metadata is verified, then
+        // checked against it
+        Tick data_latency = memSidePort.sendAtomic(pkt);
+        if (aesEngine) {
+            // The pad is generated during the data fetch, the counter is
+            // taken as on chip
+            data_latency = std::max(data_latency, aesEngine->hashLatency());
+        }
+        if (checker) {
+            checker->verify(pkt);
         }
+        if (speculative) {
+            // The data is forwarded as is and verified in the background
+            return data_latency;
+        }
+        return std::max(data_latency, verify_latency) +
+            hashEngine->hashLatency();
     }
-    return memSidePort.sendAtomic(pkt);
-}
 
-void
-SecCtrl::handleFunctional(PacketPtr pkt)
-{
-    PacketPtr readPkt = createPkt(
+    // The data and the metadata update are written once the old
+    // metadata is verified
+    PacketPtr writePkt = createPkt(
             pkt->getAddr(),
             1,
             pkt->req->getFlags(),
             pkt->req->requestorId(),
-            true
+            false
             );
-    readPort.sendFunctional(readPkt);
-    if (!pkt->isRead()) {
-        PacketPtr writePkt = createPkt(
-                pkt->getAddr(),
-                1,
-                pkt->req->getFlags(),
-                pkt->req->requestorId(),
-                false
-                );
-        writePort.sendFunctional(writePkt);
+    Tick update_latency = writePort.sendAtomic(writePkt);
+    destroyPkt(writePkt);
+    if (checker) {
+        checker->update(pkt);
+    }
+    Tick data_latency = memSidePort.sendAtomic(pkt);
+    return verify_latency + std::max(data_latency, update_latency);
+}
+
+void
+SecCtrl::handleFunctional(PacketPtr pkt)
+{
+    // The buffered writes hold the latest data of their blocks
+    if (pkt->isRead()) {
+        for (auto it = writeBuffer.rbegin(); it != writeBuffer.rend();
+                it++) {
+            if (pkt->trySatisfyFunctional(it->pkt)) {
+                return;
+            }
+        }
+    } else {
+        for (auto &write : writeBuffer) {
+            write.pkt->trySatisfyFunctional(pkt);
+        }
+    }
+
+    secStats.functionalAccesses++;
+
+    // The metadata in memory is left alone, only the checker follows the
+    // functional writes so that memory loaded by the workload verifies
+    // once it is read. Without it, program loading goes straight through.
+    if (!checker || pkt->isRead()) {
+        memSidePort.sendFunctional(pkt);
+        return;
+    }
+
+    // An access may straddle protected and unprotected blocks, only the
+    // protected ones are tracked
+    const Addr start = pkt->getAddr();
+    const Addr end = start + pkt->getSize();
+    for (Addr block = roundDown(start, (Addr)blockSize); block < end;
+            block += blockSize) {
+        if (isProtected(block)) {
+            checker->update(pkt, block, block + blockSize);
+        }
     }
     memSidePort.sendFunctional(pkt);
 }
 
+SecCtrl::SecCtrlStats::SecCtrlStats(SecCtrl &ctrl) :
+    statistics::Group(&ctrl),
+    ADD_STAT(readReqs, statistics::units::Count::get(),
+             "Number of read requests"),
+    ADD_STAT(writeReqs, statistics::units::Count::get(),
+             "Number of write requests"),
+    ADD_STAT(blockedReqs, statistics::units::Count::get(),
+             "Requests waiting for an older access to the same block"),
+    ADD_STAT(readLatency, statistics::units::Tick::get(),
+             "Ticks from accepting a read to completing it"),
+    ADD_STAT(writeLatency, statistics::units::Tick::get(),
+             "Ticks from accepting a write to completing it"),
+    ADD_STAT(verifyLatency, statistics::units::Tick::get(),
+             "Ticks spent reading and verifying the metadata of a block"),
+    ADD_STAT(specForwards, statistics::units::Count::get(),
+             "Reads whose data was forwarded before being verified"),
+    ADD_STAT(windowStalls, statistics::units::Count::get(),
+             "Reads held back because the verification window was full"),
+    ADD_STAT(hiddenVerifyTicks, statistics::units::Tick::get(),
+             "Verification ticks after the data was already forwarded"),
+    ADD_STAT(exposedVerifyTicks, statistics::units::Tick::get(),
+             "Ticks read data waited for its verification"),
+    ADD_STAT(hiddenVerifyRatio, statistics::units::Ratio::get(),
+             "Fraction of the verification latency hidden from the reads"),
+    ADD_STAT(writeFences, statistics::units::Count::get(),
+             "Writes held until older speculative reads were verified"),
+    ADD_STAT(fenceTicks, statistics::units::Tick::get(),
+             "Ticks writes were held by unverified reads"),
+    ADD_STAT(heldWrites, statistics::units::Count::get(),
+             "Writes held while the write controller re-encrypted their "
+             "counter block"),
+    ADD_STAT(postedWrites, statistics::units::Count::get(),
+             "Writes acknowledged from the write buffer"),
+    ADD_STAT(coalescedWrites, statistics::units::Count::get(),
+             "Writes replacing an older buffered write of their block"),
+    ADD_STAT(bufferFullStalls, statistics::units::Count::get(),
+             "Writes refused because the write buffer was full"),
+    ADD_STAT(bufferedReads, statistics::units::Count::get(),
+             "Reads served from the write buffer"),
+    ADD_STAT(urgentWrites, statistics::units::Count::get(),
+             "Buffered writes drained early for a read of their block"),
+    ADD_STAT(watermarkFlushes, statistics::units::Count::get(),
+             "Times the write buffer reached its high watermark"),
+    ADD_STAT(functionalAccesses, statistics::units::Count::get(),
+             "Functional accesses, program loading and proxies included"),
+    ADD_STAT(bypassReqs, statistics::units::Count::get(),
+             "Unprotected requests sent straight to memory"),
+    ADD_STAT(bypassBytes, statistics::units::Byte::get(),
+             "Bytes of the unprotected requests"),
+    ADD_STAT(padReads, statistics::units::Count::get(),
+             "Reads decrypted with a counter-mode pad"),
+    ADD_STAT(lateCounterReads, statistics::units::Count::get(),
+             "Reads whose pad was ready after their data"),
+    ADD_STAT(exposedPadTicks, statistics::units::Tick::get(),
+             "Ticks the data of the reads waited for its pad"),
+    ADD_STAT(avgExposedPadTicks, statistics::units::Rate<
+                statistics::units::Tick, statistics::units::Count>::get(),
+             "Average ticks a read waited for its pad"),
+    ADD_STAT(padLatency, statistics::units::Tick::get(),
+             "Ticks from the start of a read to its pad being ready")
+{
+    hiddenVerifyRatio.precision(4);
+    hiddenVerifyRatio = hiddenVerifyTicks /
+        (hiddenVerifyTicks + exposedVerifyTicks);
+    avgExposedPadTicks = exposedPadTicks / padReads;
+
+    readLatency
+        .init(16)
+        .flags(statistics::nozero);
+    writeLatency
+        .init(16)
+        .flags(statistics::nozero);
+    verifyLatency
+        .init(16)
+        .flags(statistics::nozero);
+    padLatency
+        .init(16)
+        .flags(statistics::nozero);
+}
+
 Port &
 SecCtrl::getPort(const std::string &if_name, PortID idx)
 {
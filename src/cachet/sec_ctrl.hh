@@ -1,7 +1,19 @@
 #ifndef __CACHET_SEC_CTRL_HH__
 #define __CACHET_SEC_CTRL_HH__
 
+#include <deque>
+#include <list>
+#include <map>
+#include <memory>
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
 #include "cachet/base_ctrl.hh"
+#include "cachet/ct_read.hh"
+#include "cachet/integrity_checker.hh"
+#include "cachet/meta_prefetcher.hh"
 #include "params/SecCtrl.hh"
 
 namespace gem5
@@ -13,26 +25,258 @@ class SecCtrl : public BaseCtrl
     enum State
     {
         Idle,
+        Blocked,
         Read,
         Write
     };
 
+    /**
+     * One entry of the transaction table. Each entry tracks the
+     * read-verify and write-update progress of a single data request.
+     */
+    struct Transaction
+    {
+        State state;
+        Addr blockAddr;
+        PacketPtr requestPkt;
+        bool needsResponse;
+        PacketPtr responsePkt;
+        bool readFinished;
+        bool writeFinished;
+        /** Tick at which the request entered the table */
+        Tick entryTick;
+        /** Tick at which the verification started */
+        Tick startTick;
+        /** Tick at which the data came back from memory */
+        Tick dataTick;
+        /** Tick at which the pad decrypting the data is ready */
+        Tick padTick;
+        /** The data was sent to the CPU before being verified */
+        bool forwarded;
+        /** The data was held back once by a full verification window */
+        bool windowStalled;
+        /** Order of a forwarded read among the speculative reads */
+        uint64_t specSeq;
+        /** Speculative reads older than this must be verified first */
+        uint64_t fenceSeq;
+        /** Tick at which a write started waiting for the verifications */
+        Tick fenceTick;
+        /**
+         * A write drained from the write buffer. It was acknowledged when
+         * posted, so the memory response is dropped.
+         */
+        bool posted;
+
+        Transaction() { clear(); }
+
+        void
+        clear()
+        {
+            state = Idle;
+            blockAddr = MaxAddr;
+            requestPkt = nullptr;
+            needsResponse = false;
+            responsePkt = nullptr;
+            readFinished = false;
+            writeFinished = false;
+            entryTick = MaxTick;
+            startTick = MaxTick;
+            dataTick = MaxTick;
+            padTick = MaxTick;
+            forwarded = false;
+            windowStalled = false;
+            specSeq = 0;
+            fenceSeq = 0;
+            fenceTick = MaxTick;
+            posted = false;
+        }
+    };
+
     void processFinishOperation() override;
 
     bool handleRequest(PacketPtr pkt) override;
     bool handleResponse(PacketPtr pkt) override;
     Tick handleAtomic(PacketPtr pkt) override;
     void handleFunctional(PacketPtr pkt) override;
+    bool isIdle() const override;
+
+    DrainState drain() override;
+    void startup() override;
+    void serialize(CheckpointOut &cp) const override;
+    void unserialize(CheckpointIn &cp) override;
 
     MemSidePort readPort;
     MemSidePort writePort;
 
-    State state;
-    PacketPtr requestPkt;
-    bool needsResponse;
-    PacketPtr responsePkt;
-    bool readFinished;
-    bool writeFinished;
+    const unsigned blockSize;
+
+    /** Metadata prefetcher observing the data accesses, if any */
+    MetaPrefetcher *prefetcher;
+
+    /**
+     * Counter-mode decryption. The pad of a read is generated by the AES
+     * engine as soon as the verification walk brings the counter, while
+     * the data is fetched, and the data is only usable once both are
+     * there. Only the part of the pad generation that outlasts the data
+     * fetch is exposed. No decryption is modelled without an engine.
+     */
+    HashEngine *aesEngine;
+    /** Start the pad of a read whose counter just arrived */
+    void counterReady(Transaction *txn);
+
+    /**
+     * Controller of the metadata writes. It may hold the data writes to
+     * some blocks, e.g. while their counter block is re-encrypted, and
+     * they wait in heldWrites until it releases them.
+     */
+    BaseCtrl *writeCtrl;
+    std::list<Transaction *> heldWrites;
+    void releaseHeldWrites();
+    /**
+     * Data accesses of the write controller sent through the memory port,
+     * behind the data writes they must not overtake
+     */
+    std::unordered_set<PacketPtr> writeCtrlPkts;
+
+    /** Transaction table, sized by the transaction_entries param */
+    std::vector<Transaction> transactions;
+    /** Entries waiting for an older access to the same block */
+    std::list<Transaction *> blockedTransactions;
+    /** In-flight packets sent on behalf of a transaction */
+    std::unordered_map<PacketPtr, Transaction *> outstandingPkts;
+    /** Transactions whose operation completes at the given tick */
+    std::multimap<Tick, Transaction *> finishQueue;
+
+    /**
+     * Speculative mode. Read data is sent to the CPU as soon as memory
+     * returns it and verified in the background. At most
+     * verificationWindow reads may be unverified at a time, and a write
+     * leaves the chip only once the reads forwarded before it are
+     * verified.
+     */
+    const bool speculative;
+    const unsigned verificationWindow;
+    /** Sequence numbers of the forwarded reads not verified yet */
+    std::set<uint64_t> unverifiedReads;
+    uint64_t nextSpecSeq;
+    /** Writes waiting for older speculative reads to be verified */
+    std::list<Transaction *> fencedWrites;
+    /** Speculative reads whose data waits for its pad */
+    std::multimap<Tick, Transaction *> padQueue;
+    void processPadQueue();
+    EventFunctionWrapper padEvent;
+
+    /** A write acknowledged early, waiting to start its transaction */
+    struct BufferedWrite
+    {
+        /** Copy of the write, owned by the controller */
+        PacketPtr pkt;
+        Addr blockAddr;
+        Tick entryTick;
+        /** A read needs this write to reach memory first */
+        bool urgent;
+    };
+
+    /**
+     * Posted write buffer. Writes are acknowledged once buffered and
+     * started in the background while no read is in flight, or in bulk
+     * once the buffer fills to the high watermark until it is back to the
+     * low one. Reads are served from the buffer when a buffered write
+     * covers them. Disabled with no entries.
+     */
+    const unsigned writeBufferEntries;
+    const unsigned writeHighWatermark;
+    const unsigned writeLowWatermark;
+    /** Latency of acknowledging a write or forwarding buffered data */
+    const Tick bufferLatency;
+    std::deque<BufferedWrite> writeBuffer;
+    /** Draining down to the low watermark */
+    bool flushingWrites;
+
+    /** Responses sent from the write buffer, in tick order */
+    std::deque<std::pair<Tick, PacketPtr>> bufferResponses;
+    EventFunctionWrapper bufferResponseEvent;
+
+    bool postWrite(PacketPtr pkt);
+    /**
+     * Serve a read from the write buffer.
+     * @return true if the read was answered, false if it has to go to
+     *         memory after the buffered writes of its block.
+     */
+    bool forwardBufferedWrite(PacketPtr pkt);
+    bool isBlockBuffered(Addr block_addr) const;
+    void respondFromBuffer(PacketPtr pkt);
+    void processBufferResponses();
+    /** Start the buffered writes the drain policy allows */
+    void drainWriteBuffer();
+
+    /** Functional MAC and tree checks of the data, if enabled */
+    std::unique_ptr<IntegrityChecker> checker;
+    /** Address corrupted by the fault injection, MaxAddr for none */
+    const Addr faultAddr;
+    const Tick faultTick;
+    EventFunctionWrapper faultEvent;
+
+    /**
+     * Data regions going through the verify and update pipeline, all
+     * the protected data when empty. Any other access goes straight to
+     * memory with no metadata traffic.
+     */
+    const std::vector<AddrRange> protectedRanges;
+    /** Unprotected requests waiting for their memory response */
+    std::unordered_set<PacketPtr> bypassPkts;
+
+    /**
+     * Whether an access goes through the pipeline. Unprotected data and
+     * addresses past the metadata bypass it, metadata addresses panic.
+     */
+    bool isProtected(Addr addr) const;
+    /** Send an unprotected request straight to memory */
+    void bypass(PacketPtr pkt);
+
+    Transaction *allocateTransaction();
+    bool isBlockInFlight(Addr block_addr) const;
+    void startTransaction(Transaction *txn);
+    void scheduleFinish(Transaction *txn, Tick when);
+    void finishTransaction(Transaction *txn);
+    void forwardData(Transaction *txn);
+    void sendWrite(Transaction *txn);
+    /** Forward stalled reads and release fenced writes */
+    void updateSpeculation();
+
+    struct SecCtrlStats : public statistics::Group
+    {
+        SecCtrlStats(SecCtrl &ctrl);
+
+        statistics::Scalar readReqs;
+        statistics::Scalar writeReqs;
+        statistics::Scalar blockedReqs;
+        statistics::Histogram readLatency;
+        statistics::Histogram writeLatency;
+        statistics::Histogram verifyLatency;
+        statistics::Scalar specForwards;
+        statistics::Scalar windowStalls;
+        statistics::Scalar hiddenVerifyTicks;
+        statistics::Scalar exposedVerifyTicks;
+        statistics::Formula hiddenVerifyRatio;
+        statistics::Scalar writeFences;
+        statistics::Scalar fenceTicks;
+        statistics::Scalar heldWrites;
+        statistics::Scalar postedWrites;
+        statistics::Scalar coalescedWrites;
+        statistics::Scalar bufferFullStalls;
+        statistics::Scalar bufferedReads;
+        statistics::Scalar urgentWrites;
+        statistics::Scalar watermarkFlushes;
+        statistics::Scalar functionalAccesses;
+        statistics::Scalar bypassReqs;
+        statistics::Scalar bypassBytes;
+        statistics::Scalar padReads;
+        statistics::Scalar lateCounterReads;
+        statistics::Scalar exposedPadTicks;
+        statistics::Formula avgExposedPadTicks;
+        statistics::Histogram padLatency;
+    } secStats;
 
     SecCtrl(const SecCtrlParams &p);
     virtual Port& getPort(const std::string &if_name,
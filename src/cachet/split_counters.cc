@@ -0,0 +1,263 @@
+#include "cachet/split_counters.hh"
+
+#include <cstring>
+
+#include "base/intmath.hh"
+#include "base/trace.hh"
+#include "debug/SplitCounters.hh"
+
+namespace gem5
+{
+
+SplitCounters::SplitCounters(BaseCtrl &_ctrl, BaseCtrl::MemSidePort &_port) :
+    ctrl(_ctrl),
+    layout(_ctrl.layout),
+    port(_port),
+    burstCounter(MaxAddr),
+    burstReadsLeft(0),
+    burstRequestorId(0),
+    stats(_ctrl)
+{
+}
+
+bool
+SplitCounters::increment(Addr data_addr)
+{
+    assert(enabled());
+    stats.increments++;
+
+    Addr block = roundDown(data_addr, (Addr)layout->getBlockSize());
+    uint32_t &minor = minors[block];
+    if (++minor < (1U << layout->getMinorCounterBits())) {
+        return false;
+    }
+
+    // The major counter moves on and every block of the counter block
+    // starts over with a zero minor counter
+    Addr counter = layout->counterAddr(data_addr);
+    majors[counter]++;
+    for (unsigned i = 0; i < layout->getCounterArity(); i++) {
+        minors.erase(layout->childAddr(counter, i));
+    }
+
+    DPRINTF(SplitCounters, "Minor counter of %#x overflowed, major of %#x "
+            "is now %d\n", block, counter, majors[counter]);
+    stats.overflows++;
+    return true;
+}
+
+void
+SplitCounters::encode(Addr counter, uint8_t *block) const
+{
+    assert(enabled());
+    std::memset(block, 0, layout->getBlockSize());
+
+    auto major = majors.find(counter);
+    if (major != majors.end()) {
+        layout->setCounterField(block, 0, major->second);
+    }
+    for (unsigned i = 0; i < layout->getCounterArity(); i++) {
+        auto minor = minors.find(layout->childAddr(counter, i));
+        if (minor != minors.end()) {
+            layout->setCounterField(block, i + 1, minor->second);
+        }
+    }
+}
+
+PacketPtr
+SplitCounters::createCounterPkt(PacketPtr pkt) const
+{
+    PacketPtr cnt_pkt = ctrl.createPkt(
+            layout->counterAddr(pkt->getAddr()),
+            layout->getBlockSize(),
+            pkt->req->getFlags(),
+            pkt->req->requestorId(),
+            false
+            );
+    if (enabled()) {
+        encode(cnt_pkt->getAddr(), cnt_pkt->getPtr<uint8_t>());
+    }
+    return cnt_pkt;
+}
+
+bool
+SplitCounters::holds(Addr data_addr) const
+{
+    return burstCounter != MaxAddr &&
+        layout->counterAddr(data_addr) == burstCounter;
+}
+
+void
+SplitCounters::sendBurstPkt(Addr addr, bool is_read, const uint8_t *data)
+{
+    PacketPtr pkt = ctrl.createPkt(
+            addr,
+            layout->getBlockSize(),
+            0,
+            burstRequestorId,
+            is_read
+            );
+    if (data) {
+        pkt->setData(data);
+    }
+    stats.burstAccesses++;
+    stats.burstBytes += pkt->getSize();
+    burstPkts.insert(pkt);
+    if (layout->isData(addr) && ctrl.sendData) {
+        ctrl.sendData(pkt);
+    } else {
+        port.sendPacket(pkt);
+    }
+}
+
+void
+SplitCounters::write(PacketPtr pkt)
+{
+    if (!increment(pkt->getAddr())) {
+        return;
+    }
+
+    assert(!busy());
+    burstCounter = layout->counterAddr(pkt->getAddr());
+    burstReadsLeft = 0;
+    burstRequestorId = pkt->req->requestorId();
+
+    DPRINTF(SplitCounters, "Re-encrypt the blocks of counter %#x\n",
+            burstCounter);
+    // The block of the overflowing write is written under the new major
+    // counter by that write itself
+    Addr written = roundDown(pkt->getAddr(), (Addr)layout->getBlockSize());
+    for (unsigned i = 0; i < layout->getCounterArity(); i++) {
+        Addr block = layout->childAddr(burstCounter, i);
+        if (block != MaxAddr && block != written) {
+            sendBurstPkt(block, true);
+            burstReadsLeft++;
+        }
+    }
+    if (!busy()) {
+        finishBurst();
+    }
+}
+
+void
+SplitCounters::finishBurst()
+{
+    DPRINTF(SplitCounters, "Counter %#x re-encrypted\n", burstCounter);
+    burstCounter = MaxAddr;
+    if (ctrl.dataReleased) {
+        ctrl.dataReleased();
+    }
+    ctrl.cpuSidePort.trySendRetry();
+}
+
+bool
+SplitCounters::handleResponse(PacketPtr pkt)
+{
+    auto it = burstPkts.find(pkt);
+    if (it == burstPkts.end()) {
+        return false;
+    }
+    burstPkts.erase(it);
+
+    if (pkt->isRead()) {
+        // Write the data read back under the new major counter. The data
+        // writes to the group are held meanwhile, so it is still current
+        Addr addr = pkt->getAddr();
+        sendBurstPkt(addr, false, pkt->getConstPtr<uint8_t>());
+        ctrl.destroyPkt(pkt);
+        stats.reencryptedBlocks++;
+
+        if (--burstReadsLeft == 0 && !layout->hasMacInEcc()) {
+            // All the ciphertexts are known, rewrite their MACs
+            const unsigned macs_per_line =
+                layout->getBlockSize() / layout->getMacSize();
+            for (unsigned i = 0; i < layout->getCounterArity();
+                    i += macs_per_line) {
+                Addr block = layout->childAddr(burstCounter, i);
+                if (block == MaxAddr) {
+                    break;
+                }
+                sendBurstPkt(roundDown(layout->macAddr(block),
+                        (Addr)layout->getBlockSize()), false);
+            }
+        }
+        return true;
+    }
+
+    ctrl.destroyPkt(pkt);
+    if (!busy()) {
+        finishBurst();
+    }
+    return true;
+}
+
+void
+SplitCounters::serialize(CheckpointOut &cp) const
+{
+    assert(!busy());
+
+    std::vector<Addr> minor_blocks;
+    std::vector<uint32_t> minor_values;
+    for (const auto &minor : minors) {
+        minor_blocks.push_back(minor.first);
+        minor_values.push_back(minor.second);
+    }
+    std::vector<Addr> major_counters;
+    std::vector<uint64_t> major_values;
+    for (const auto &major : majors) {
+        major_counters.push_back(major.first);
+        major_values.push_back(major.second);
+    }
+
+    SERIALIZE_CONTAINER(minor_blocks);
+    SERIALIZE_CONTAINER(minor_values);
+    SERIALIZE_CONTAINER(major_counters);
+    SERIALIZE_CONTAINER(major_values);
+}
+
+void
+SplitCounters::unserialize(CheckpointIn &cp)
+{
+    std::vector<Addr> minor_blocks;
+    std::vector<uint32_t> minor_values;
+    std::vector<Addr> major_counters;
+    std::vector<uint64_t> major_values;
+
+    UNSERIALIZE_CONTAINER(minor_blocks);
+    UNSERIALIZE_CONTAINER(minor_values);
+    UNSERIALIZE_CONTAINER(major_counters);
+    UNSERIALIZE_CONTAINER(major_values);
+    fatal_if(minor_blocks.size() != minor_values.size() ||
+            major_counters.size() != major_values.size(),
+            "Corrupt split counter checkpoint");
+
+    minors.clear();
+    for (size_t i = 0; i < minor_blocks.size(); i++) {
+        minors[minor_blocks[i]] = minor_values[i];
+    }
+    majors.clear();
+    for (size_t i = 0; i < major_counters.size(); i++) {
+        majors[major_counters[i]] = major_values[i];
+    }
+}
+
+SplitCounters::SplitCounterStats::SplitCounterStats(BaseCtrl &ctrl) :
+    statistics::Group(&ctrl, "splitCounters"),
+    ADD_STAT(increments, statistics::units::Count::get(),
+             "Number of minor counter increments"),
+    ADD_STAT(overflows, statistics::units::Count::get(),
+             "Number of minor counter overflows"),
+    ADD_STAT(overflowRate, statistics::units::Ratio::get(),
+             "Fraction of the increments overflowing a minor counter"),
+    ADD_STAT(reencryptedBlocks, statistics::units::Count::get(),
+             "Number of data blocks re-encrypted after an overflow"),
+    ADD_STAT(burstAccesses, statistics::units::Count::get(),
+             "Number of memory accesses of the re-encryption bursts"),
+    ADD_STAT(burstBytes, statistics::units::Byte::get(),
+             "Number of bytes moved by the re-encryption bursts")
+{
+    overflowRate.precision(6);
+    overflowRate = overflows / increments;
+}
+
+} // namespace gem5
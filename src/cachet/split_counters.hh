@@ -0,0 +1,115 @@
+#ifndef __CACHET_SPLIT_COUNTERS_HH__
+#define __CACHET_SPLIT_COUNTERS_HH__
+
+#include <unordered_map>
+#include <unordered_set>
+
+#include "cachet/base_ctrl.hh"
+#include "sim/serialize.hh"
+
+namespace gem5
+{
+
+/**
+ * Minor counter tracking of a write controller in split-counter mode.
+ *
+ * Every data block has a minor counter bumped on each write, and the
+ * blocks of a counter block share its major counter. When a minor counter
+ * wraps, the major counter is incremented, the minor counters of the
+ * counter block are reset and all its data blocks are re-encrypted: each
+ * one is read and written back, and the MAC lines covering them are
+ * rewritten once the reads are done. The block of the overflowing write
+ * is left to that write. The data reads and write-backs go through the
+ * port of the data writes, see BaseCtrl::sendData, so that they come
+ * after the writes already sent to the group. The secure controller
+ * holds the data writes to the other blocks until the burst is done, see
+ * BaseCtrl::holdsData.
+ *
+ * The counter values are the persistent state of the tree and are saved
+ * in checkpoints. A burst in flight is not, the owner drains it first.
+ */
+class SplitCounters : public Serializable
+{
+  private:
+    BaseCtrl &ctrl;
+    IntegrityLayout *layout;
+    /** Port the re-encryption burst is sent through */
+    BaseCtrl::MemSidePort &port;
+
+    /** Minor counter of every data block written, absent means 0 */
+    std::unordered_map<Addr, uint32_t> minors;
+    /** Major counter of every counter block, absent means 0 */
+    std::unordered_map<Addr, uint64_t> majors;
+
+    /** Reads and writes of the burst still in flight */
+    std::unordered_set<PacketPtr> burstPkts;
+    /** Counter block being re-encrypted */
+    Addr burstCounter;
+    unsigned burstReadsLeft;
+    RequestorID burstRequestorId;
+
+    /** Send a burst access, a write carrying a copy of data if given */
+    void sendBurstPkt(Addr addr, bool is_read,
+                      const uint8_t *data=nullptr);
+    /** End the burst and release the data writes held for it */
+    void finishBurst();
+
+    struct SplitCounterStats : public statistics::Group
+    {
+        SplitCounterStats(BaseCtrl &ctrl);
+
+        statistics::Scalar increments;
+        statistics::Scalar overflows;
+        statistics::Formula overflowRate;
+        statistics::Scalar reencryptedBlocks;
+        statistics::Scalar burstAccesses;
+        statistics::Scalar burstBytes;
+    } stats;
+
+  public:
+    SplitCounters(BaseCtrl &ctrl, BaseCtrl::MemSidePort &port);
+
+    bool enabled() const { return layout->hasSplitCounters(); }
+    /** Whether a re-encryption burst is still in flight */
+    bool busy() const { return !burstPkts.empty(); }
+    /**
+     * Whether the data writes to a block must wait for the burst
+     * re-encrypting its counter block, so that none lands between a
+     * burst read and its write-back.
+     */
+    bool holds(Addr data_addr) const;
+
+    /**
+     * Bump the minor counter of a data block.
+     * @return true if it overflowed, the counter block is then reset
+     */
+    bool increment(Addr data_addr);
+    /**
+     * Write the current values of a counter block into a block buffer,
+     * in the packing of IntegrityLayout::counterField.
+     */
+    void encode(Addr counter, uint8_t *block) const;
+    /**
+     * Counter block write of a data write. In split-counter mode it
+     * carries the counter values, so that the meta cache and its
+     * compressor see the real contents of the counter blocks.
+     */
+    PacketPtr createCounterPkt(PacketPtr pkt) const;
+    /**
+     * Account for a data write and start the re-encryption burst of its
+     * counter block if the minor counter overflows.
+     */
+    void write(PacketPtr pkt);
+    /**
+     * Handle a response of the burst.
+     * @return true if the packet belonged to the burst.
+     */
+    bool handleResponse(PacketPtr pkt);
+
+    void serialize(CheckpointOut &cp) const override;
+    void unserialize(CheckpointIn &cp) override;
+};
+
+} // namespace gem5
+
+#endif // __CACHET_SPLIT_COUNTERS_HH__
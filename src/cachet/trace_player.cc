@@ -0,0 +1,228 @@
+#include "cachet/trace_player.hh"
+
+#include <algorithm>
+
+#include "base/trace.hh"
+#include "debug/TracePlayer.hh"
+#include "proto/packet.pb.h"
+#include "sim/core.hh"
+#include "sim/sim_exit.hh"
+#include "sim/stats.hh"
+#include "sim/system.hh"
+
+namespace gem5
+{
+
+TracePlayer::TracePlayer(const TracePlayerParams &p) :
+    ClockedObject(p),
+    port(name() + ".port", *this),
+    trace(p.trace_file),
+    requestorId(p.system->getRequestorId(this)),
+    maxOutstanding(p.max_outstanding),
+    timed(p.timed),
+    traceDone(false),
+    traceStart(0),
+    replayStart(0),
+    outstanding(0),
+    retryPkt(nullptr),
+    issueEvent([this]{ issue(); }, name()),
+    stats(*this)
+{
+    DPRINTF(TracePlayer, "Constructing\n");
+    fatal_if(maxOutstanding == 0, "%s needs at least one outstanding "
+            "request", name());
+
+    ProtoMessage::PacketHeader header;
+    fatal_if(!trace.read(header), "%s: failed to read the header of %s",
+            name(), p.trace_file);
+    fatal_if(header.tick_freq() != sim_clock::Frequency,
+            "%s: trace recorded with a tick frequency of %d",
+            name(), header.tick_freq());
+}
+
+void
+TracePlayer::readNext()
+{
+    ProtoMessage::Packet msg;
+    while (trace.read(msg)) {
+        MemCmd cmd((MemCmd::Command)msg.cmd());
+        // Only the data movement matters here, whatever coherence
+        // request produced it
+        if (!cmd.isRead() && !cmd.isWrite()) {
+            stats.skipped++;
+            continue;
+        }
+
+        next.tick = msg.tick();
+        next.isRead = cmd.isRead();
+        next.addr = msg.addr();
+        next.size = msg.size();
+        next.flags = msg.has_flags() ? msg.flags() : 0;
+        return;
+    }
+    traceDone = true;
+}
+
+void
+TracePlayer::init()
+{
+    ClockedObject::init();
+    fatal_if(!port.isConnected(), "%s: port not connected", name());
+
+    readNext();
+    if (!traceDone) {
+        traceStart = next.tick;
+    }
+}
+
+void
+TracePlayer::startup()
+{
+    replayStart = curTick();
+    if (traceDone) {
+        exitSimLoop("trace replay done");
+        return;
+    }
+    scheduleIssue();
+}
+
+void
+TracePlayer::scheduleIssue()
+{
+    if (traceDone || retryPkt || outstanding >= maxOutstanding ||
+            issueEvent.scheduled()) {
+        return;
+    }
+
+    Tick when = nextCycle();
+    if (timed) {
+        when = std::max(when, replayStart + next.tick - traceStart);
+    }
+    schedule(issueEvent, when);
+}
+
+void
+TracePlayer::issue()
+{
+    RequestPtr req = std::make_shared<Request>(next.addr, next.size,
+            next.flags, requestorId);
+    PacketPtr pkt;
+    if (next.isRead) {
+        pkt = Packet::createRead(req);
+    } else {
+        pkt = Packet::createWrite(req);
+    }
+    // The trace has no data, the writes carry zeros
+    pkt->allocate();
+    if (!next.isRead) {
+        std::fill_n(pkt->getPtr<uint8_t>(), next.size, 0);
+    }
+
+    DPRINTF(TracePlayer, "Issue %s\n", pkt->print());
+    outstanding++;
+    if (next.isRead) {
+        stats.reads++;
+    } else {
+        stats.writes++;
+    }
+
+    readNext();
+    if (!port.sendTimingReq(pkt)) {
+        stats.retries++;
+        retryPkt = pkt;
+        return;
+    }
+    scheduleIssue();
+}
+
+void
+TracePlayer::recvRetry()
+{
+    assert(retryPkt);
+    PacketPtr pkt = retryPkt;
+    if (!port.sendTimingReq(pkt)) {
+        return;
+    }
+    retryPkt = nullptr;
+    scheduleIssue();
+}
+
+void
+TracePlayer::recvResponse(PacketPtr pkt)
+{
+    DPRINTF(TracePlayer, "Response for %s\n", pkt->print());
+    Tick latency = curTick() - pkt->req->time();
+    if (pkt->isRead()) {
+        stats.readLatency.sample(latency);
+        stats.bytesRead += pkt->getSize();
+    } else {
+        stats.writeLatency.sample(latency);
+        stats.bytesWritten += pkt->getSize();
+    }
+    delete pkt;
+
+    assert(outstanding > 0);
+    outstanding--;
+    if (traceDone && outstanding == 0) {
+        exitSimLoop("trace replay done");
+        return;
+    }
+    scheduleIssue();
+}
+
+bool
+TracePlayer::RequestorPort::recvTimingResp(PacketPtr pkt)
+{
+    player.recvResponse(pkt);
+    return true;
+}
+
+void
+TracePlayer::RequestorPort::recvReqRetry()
+{
+    player.recvRetry();
+}
+
+Port &
+TracePlayer::getPort(const std::string &if_name, PortID idx)
+{
+    if (if_name == "port") {
+        return port;
+    }
+    return ClockedObject::getPort(if_name, idx);
+}
+
+TracePlayer::TracePlayerStats::TracePlayerStats(TracePlayer &player) :
+    statistics::Group(&player),
+    ADD_STAT(reads, statistics::units::Count::get(),
+             "Number of reads issued"),
+    ADD_STAT(writes, statistics::units::Count::get(),
+             "Number of writes issued"),
+    ADD_STAT(bytesRead, statistics::units::Byte::get(),
+             "Number of bytes read"),
+    ADD_STAT(bytesWritten, statistics::units::Byte::get(),
+             "Number of bytes written"),
+    ADD_STAT(skipped, statistics::units::Count::get(),
+             "Trace records that are neither reads nor writes"),
+    ADD_STAT(retries, statistics::units::Count::get(),
+             "Requests refused by the memory system"),
+    ADD_STAT(readLatency, statistics::units::Tick::get(),
+             "Ticks from issuing a read to its response"),
+    ADD_STAT(writeLatency, statistics::units::Tick::get(),
+             "Ticks from issuing a write to its response"),
+    ADD_STAT(bandwidth, statistics::units::Rate<
+                statistics::units::Byte, statistics::units::Second>::get(),
+             "Bandwidth delivered to the trace")
+{
+    readLatency
+        .init(16)
+        .flags(statistics::nozero);
+    writeLatency
+        .init(16)
+        .flags(statistics::nozero);
+
+    bandwidth.precision(0);
+    bandwidth = (bytesRead + bytesWritten) / simSeconds;
+}
+
+} // namespace gem5
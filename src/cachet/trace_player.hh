@@ -0,0 +1,108 @@
+#ifndef __CACHET_TRACE_PLAYER_HH__
+#define __CACHET_TRACE_PLAYER_HH__
+
+#include <string>
+
+#include "base/statistics.hh"
+#include "mem/port.hh"
+#include "mem/request.hh"
+#include "params/TracePlayer.hh"
+#include "proto/protoio.hh"
+#include "sim/clocked_object.hh"
+
+namespace gem5
+{
+
+/**
+ * Replays a memory trace recorded in the packet.proto format (by a
+ * CommMonitor for instance) straight into the memory system, so that a
+ * Cachet configuration can be evaluated without CPUs or caches.
+ *
+ * Reads and writes are issued at most one per cycle, either at the ticks
+ * of the trace, shifted to start at the beginning of the simulation, or
+ * back to back. The number of requests in flight is capped, and the
+ * simulation exits once the last response came back.
+ */
+class TracePlayer : public ClockedObject
+{
+  private:
+    class RequestorPort : public RequestPort
+    {
+      private:
+        TracePlayer &player;
+
+      public:
+        RequestorPort(const std::string &name, TracePlayer &_player) :
+            RequestPort(name, &_player), player(_player)
+        {}
+
+      protected:
+        bool recvTimingResp(PacketPtr pkt) override;
+        void recvReqRetry() override;
+    };
+
+    /** An access read from the trace */
+    struct TraceElement
+    {
+        Tick tick;
+        bool isRead;
+        Addr addr;
+        unsigned size;
+        Request::FlagsType flags;
+    };
+
+    RequestorPort port;
+    ProtoInputStream trace;
+    const RequestorID requestorId;
+    const unsigned maxOutstanding;
+    /** Follow the timing of the trace instead of issuing back to back */
+    const bool timed;
+
+    /** Next access to issue, valid unless traceDone */
+    TraceElement next;
+    bool traceDone;
+    /** Tick of the first access of the trace */
+    Tick traceStart;
+    /** Tick at which the replay started */
+    Tick replayStart;
+
+    unsigned outstanding;
+    /** Request refused by the memory system, resent on a retry */
+    PacketPtr retryPkt;
+
+    EventFunctionWrapper issueEvent;
+
+    /** Read the next read or write of the trace, skipping the rest */
+    void readNext();
+    void issue();
+    void scheduleIssue();
+    void recvResponse(PacketPtr pkt);
+    void recvRetry();
+
+    struct TracePlayerStats : public statistics::Group
+    {
+        TracePlayerStats(TracePlayer &player);
+
+        statistics::Scalar reads;
+        statistics::Scalar writes;
+        statistics::Scalar bytesRead;
+        statistics::Scalar bytesWritten;
+        statistics::Scalar skipped;
+        statistics::Scalar retries;
+        statistics::Histogram readLatency;
+        statistics::Histogram writeLatency;
+        statistics::Formula bandwidth;
+    } stats;
+
+  public:
+    TracePlayer(const TracePlayerParams &p);
+
+    void init() override;
+    void startup() override;
+    Port &getPort(const std::string &if_name,
+                  PortID idx=InvalidPortID) override;
+};
+
+} // namespace gem5
+
+#endif // __CACHET_TRACE_PLAYER_HH__
@@ -58,6 +58,19 @@ class DRAMInterface(MemInterface):
     max_accesses_per_row = Param.Unsigned(16, "Max accesses per row before "
                                           "closing");
 
+    # Integrity metadata stored above the protected data, see src/cachet.
+    # Its bursts get their own row buffer stats. With row_data_bytes,
+    # every row keeps its tail for the metadata of its own data, e.g.
+    # its MACs, instead of the metadata filling rows of its own
+    metadata_start = Param.Addr(0, "Start of the integrity metadata, "
+                                "0 if the memory holds none")
+    row_data_bytes = Param.Unsigned(0, "Data bytes of every row when the "
+                                    "metadata shares the rows of its data, "
+                                    "0 for the plain address mapping")
+    row_meta_bytes = Param.Unsigned(0, "Bytes of the metadata, from "
+                                    "metadata_start, placed in the tail "
+                                    "of every data row")
+
     # default to 0 bank groups per rank, indicating bank group architecture
     # is not used
     # update per memory class when bank group architecture is supported
@@ -94,6 +94,12 @@ class MemInterface(AbstractMemory):
     tBURST = Param.Latency("Burst duration "
                            "(typically burst length / 2 cycles)")
 
+    # bytes transferred with every burst on top of its data, e.g. a MAC
+    # travelling with the data it protects. They lengthen the burst by
+    # the beats they need on the data bus, 0 if they use ECC chip bits
+    extra_burst_bytes = Param.Unsigned(0, "Extra bytes sent along with "
+                                       "every burst")
+
     # write-to-read, same rank turnaround penalty
     tWTR = Param.Latency("Write to read, same rank switching time")
 
@@ -977,7 +977,9 @@ BaseCache::updateCompressionData(CacheBlk *&blk, const uint64_t* data,
                                  PacketList &writebacks)
 {
     // tempBlock does not exist in the tags, so don't do anything for it.
-    if (blk == tempBlock) {
+    // Neither do blocks that are never compressed.
+    if (blk == tempBlock ||
+        !compressor->compressible(regenerateBlkAddr(blk))) {
         return true;
     }
 
@@ -1622,7 +1624,7 @@ BaseCache::allocateBlock(const PacketPtr pkt, PacketList &writebacks)
     // compressor is used, the compression/decompression methods are called to
     // calculate the amount of extra cycles needed to read or write compressed
     // blocks.
-    if (compressor && pkt->hasData()) {
+    if (compressor && pkt->hasData() && compressor->compressible(addr)) {
         const auto comp_data = compressor->compress(
             pkt->getConstPtr<uint64_t>(), compression_lat, decompression_lat);
         blk_size_bits = comp_data->getSizeBits();
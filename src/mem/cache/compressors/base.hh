@@ -206,6 +206,15 @@ class Base : public SimObject
     /** The cache can only be set once. */
     virtual void setCache(BaseCache *_cache);
 
+    /**
+     * Whether the block at the given address may be compressed. The other
+     * blocks are stored uncompressed, at their full size.
+     *
+     * @param addr The block address.
+     * @return Whether the block is compressible.
+     */
+    virtual bool compressible(Addr addr) const { return true; }
+
     /**
      * Apply the compression process to the cache line. Ignores compression
      * cycles.
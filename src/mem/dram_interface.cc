@@ -579,6 +579,11 @@ DRAMInterface::doBurstAccess(MemPacket* mem_pkt, Tick next_burst_at,
         stats.readBursts++;
         if (row_hit)
             stats.readRowHits++;
+        if (isMeta(mem_pkt->getAddr())) {
+            metaStats->metaReadBursts++;
+            if (row_hit)
+                metaStats->metaReadRowHits++;
+        }
         stats.bytesRead += burstSize;
         stats.perBankRdBursts[mem_pkt->bankId]++;
 
@@ -608,6 +613,11 @@ DRAMInterface::doBurstAccess(MemPacket* mem_pkt, Tick next_burst_at,
         stats.writeBursts++;
         if (row_hit)
             stats.writeRowHits++;
+        if (isMeta(mem_pkt->getAddr())) {
+            metaStats->metaWriteBursts++;
+            if (row_hit)
+                metaStats->metaWriteRowHits++;
+        }
         stats.bytesWritten += burstSize;
         stats.perBankWrBursts[mem_pkt->bankId]++;
 
@@ -639,22 +649,26 @@ DRAMInterface::DRAMInterface(const DRAMInterfaceParams &_p)
       bankGroupArch(_p.bank_groups_per_rank > 0),
       tRL(_p.tCL),
       tWL(_p.tCWL),
-      tBURST_MIN(_p.tBURST_MIN), tBURST_MAX(_p.tBURST_MAX),
+      tBURST_MIN(_p.tBURST_MIN + tBURST_EXTRA),
+      tBURST_MAX(_p.tBURST_MAX + tBURST_EXTRA),
       tCCD_L_WR(_p.tCCD_L_WR), tCCD_L(_p.tCCD_L),
       tRCD_RD(_p.tRCD), tRCD_WR(_p.tRCD_WR),
       tRP(_p.tRP), tRAS(_p.tRAS), tWR(_p.tWR), tRTP(_p.tRTP),
       tRFC(_p.tRFC), tREFI(_p.tREFI), tRRD(_p.tRRD), tRRD_L(_p.tRRD_L),
       tPPD(_p.tPPD), tAAD(_p.tAAD),
       tXAW(_p.tXAW), tXP(_p.tXP), tXS(_p.tXS),
-      clkResyncDelay(_p.tBURST_MAX),
+      clkResyncDelay(_p.tBURST_MAX + tBURST_EXTRA),
       dataClockSync(_p.data_clock_sync),
       burstInterleave(tBURST != tBURST_MIN),
       twoCycleActivate(_p.two_cycle_activate),
       activationLimit(_p.activation_limit),
-      wrToRdDlySameBG(tWL + _p.tBURST_MAX + _p.tWTR_L),
-      rdToWrDlySameBG(_p.tRTW + _p.tBURST_MAX),
+      wrToRdDlySameBG(tWL + _p.tBURST_MAX + tBURST_EXTRA + _p.tWTR_L),
+      rdToWrDlySameBG(_p.tRTW + _p.tBURST_MAX + tBURST_EXTRA),
       pageMgmt(_p.page_policy),
       maxAccessesPerRow(_p.max_accesses_per_row),
+      metaStart(_p.metadata_start),
+      rowDataBytes(_p.row_data_bytes), rowMetaBytes(_p.row_meta_bytes),
+      metaCtrlStart(0), dataRows(0),
       timeStampOffset(0), activeRank(0),
       enableDRAMPowerdown(_p.enable_dram_powerdown),
       lastStatsResetTick(0),
@@ -696,6 +710,34 @@ DRAMInterface::DRAMInterface(const DRAMInterfaceParams &_p)
 
     rowsPerBank = capacity / (rowBufferSize * banksPerRank * ranksPerChannel);
 
+    if (metaStart) {
+        metaStats.reset(new MetaStats(*this));
+    }
+
+    if (rowDataBytes) {
+        fatal_if(!metaStart, "Placing the metadata in the data rows needs "
+                 "the metadata start\n");
+        fatal_if(addrMapping == enums::RoCoRaBaCh, "Placing the metadata in "
+                 "the data rows needs each row to be contiguous, use "
+                 "RoRaBaCoCh or RoRaBaChCo\n");
+        fatal_if(rowDataBytes % burstSize || rowMetaBytes % burstSize ||
+                 rowDataBytes + rowMetaBytes > rowBufferSize,
+                 "%d data and %d metadata bytes per row do not fit a %d "
+                 "byte row in whole bursts\n", rowDataBytes, rowMetaBytes,
+                 rowBufferSize);
+        metaCtrlStart = getCtrlAddr(metaStart);
+        fatal_if(metaCtrlStart == MaxAddr, "Metadata start %#x is outside "
+                 "of the memory range\n", metaStart);
+        dataRows = divCeil(metaCtrlStart, (Addr)rowDataBytes);
+
+        // The tail of every data row left over pushes the top of the
+        // range past the device
+        Addr top = placeInRow(AbstractMemory::size() - 1) + 1;
+        warn_if(top > capacity, "The top %d bytes of the memory range "
+                "alias other rows with the metadata row placement\n",
+                top - capacity);
+    }
+
     // some basic sanity checks
     if (tREFI <= tRP || tREFI <= tRFC) {
         fatal("tREFI (%d) must be larger than tRP (%d) and tRFC (%d)\n",
@@ -831,6 +873,22 @@ DRAMInterface::isBusy(bool read_queue_empty, bool all_writes_nvm)
     return (busy_ranks == ranksPerChannel);
 }
 
+Addr
+DRAMInterface::placeInRow(Addr addr) const
+{
+    if (addr < metaCtrlStart) {
+        // Data, the tail of its row is left for its metadata
+        return addr / rowDataBytes * rowBufferSize + addr % rowDataBytes;
+    }
+
+    Addr meta = addr - metaCtrlStart;
+    if (meta < dataRows * rowMetaBytes) {
+        return meta / rowMetaBytes * rowBufferSize + rowDataBytes +
+            meta % rowMetaBytes;
+    }
+    return dataRows * rowBufferSize + meta - dataRows * rowMetaBytes;
+}
+
 MemPacket*
 DRAMInterface::decodePacket(const PacketPtr pkt, Addr pkt_addr,
                        unsigned size, bool is_read, uint8_t pseudo_channel)
@@ -846,6 +904,9 @@ DRAMInterface::decodePacket(const PacketPtr pkt, Addr pkt_addr,
 
     // Get packed address, starting at 0
     Addr addr = getCtrlAddr(pkt_addr);
+    if (rowDataBytes) {
+        addr = placeInRow(addr);
+    }
 
     // truncate the address to a memory burst, which makes it unique to
     // a specific buffer, row, bank, rank and channel
@@ -1916,6 +1977,8 @@ DRAMInterface::DRAMStats::regStats()
 {
     using namespace statistics;
 
+    statistics::Group::regStats();
+
     avgQLat.precision(2);
     avgBusLat.precision(2);
     avgMemAccLat.precision(2);
@@ -1959,6 +2022,30 @@ DRAMInterface::DRAMStats::regStats()
         (writeBursts + readBursts) * 100;
 }
 
+DRAMInterface::MetaStats::MetaStats(DRAMInterface &dram)
+    : statistics::Group(&dram.stats),
+    ADD_STAT(metaReadBursts, statistics::units::Count::get(),
+             "Number of integrity metadata read bursts"),
+    ADD_STAT(metaWriteBursts, statistics::units::Count::get(),
+             "Number of integrity metadata write bursts"),
+    ADD_STAT(metaReadRowHits, statistics::units::Count::get(),
+             "Number of row buffer hits during metadata reads"),
+    ADD_STAT(metaWriteRowHits, statistics::units::Count::get(),
+             "Number of row buffer hits during metadata writes"),
+    ADD_STAT(metaRowHitRate, statistics::units::Ratio::get(),
+             "Row buffer hit rate for the metadata bursts")
+{
+}
+
+void
+DRAMInterface::MetaStats::regStats()
+{
+    metaRowHitRate.precision(2);
+
+    metaRowHitRate = (metaReadRowHits + metaWriteRowHits) /
+        (metaReadBursts + metaWriteBursts) * 100;
+}
+
 DRAMInterface::RankStats::RankStats(DRAMInterface &_dram, Rank &_rank)
     : statistics::Group(&_dram, csprintf("rank%d", _rank.rank).c_str()),
     rank(_rank),
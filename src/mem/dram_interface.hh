@@ -46,6 +46,8 @@
 #ifndef __DRAM_INTERFACE_HH__
 #define __DRAM_INTERFACE_HH__
 
+#include <memory>
+
 #include "mem/drampower.hh"
 #include "mem/mem_interface.hh"
 #include "params/DRAMInterface.hh"
@@ -524,6 +526,33 @@ class DRAMInterface : public MemInterface
      */
     const uint32_t maxAccessesPerRow;
 
+    /**
+     * Integrity metadata stored from metaStart, 0 if none. Its bursts
+     * are counted apart in the row buffer stats.
+     */
+    const Addr metaStart;
+    /**
+     * Placement of the metadata in the rows of its data. Every row holds
+     * rowDataBytes of data followed by the rowMetaBytes of metadata
+     * covering them, taken in order from metaStart, and the rest of the
+     * metadata fills the rows after the last data row. Disabled if
+     * rowDataBytes is 0.
+     */
+    const uint32_t rowDataBytes;
+    const uint32_t rowMetaBytes;
+    /** Controller-local start of the metadata */
+    Addr metaCtrlStart;
+    /** Rows holding data, and thus a slice of metadata */
+    Addr dataRows;
+
+    bool isMeta(Addr addr) const { return metaStart && addr >= metaStart; }
+
+    /**
+     * Controller-local address whose plain decoding gives the row of an
+     * address under the metadata row placement.
+     */
+    Addr placeInRow(Addr addr) const;
+
     // timestamp offset
     uint64_t timeStampOffset;
 
@@ -615,6 +644,26 @@ class DRAMInterface : public MemInterface
 
     DRAMStats stats;
 
+    /**
+     * Row hits of the integrity metadata bursts, merged into the DRAM
+     * stats and only registered when there is metadata, so that the
+     * stats of a plain DRAM are unchanged
+     */
+    struct MetaStats : public statistics::Group
+    {
+        MetaStats(DRAMInterface &dram);
+
+        void regStats() override;
+
+        statistics::Scalar metaReadBursts;
+        statistics::Scalar metaWriteBursts;
+        statistics::Scalar metaReadRowHits;
+        statistics::Scalar metaWriteRowHits;
+        statistics::Formula metaRowHitRate;
+    };
+
+    std::unique_ptr<MetaStats> metaStats;
+
     /**
       * Vector of dram ranks
       */
@@ -42,6 +42,7 @@
 
 #include "base/bitfield.hh"
 #include "base/cprintf.hh"
+#include "base/intmath.hh"
 #include "base/trace.hh"
 #include "sim/system.hh"
 
@@ -65,7 +66,11 @@ MemInterface::MemInterface(const MemInterfaceParams &_p)
                       range.granularity() / burstSize : 1),
       ranksPerChannel(_p.ranks_per_channel),
       banksPerRank(_p.banks_per_rank), rowsPerBank(0),
-      tCK(_p.tCK), tCS(_p.tCS), tBURST(_p.tBURST),
+      tCK(_p.tCK), tCS(_p.tCS),
+      tBURST_EXTRA(divCeil(_p.extra_burst_bytes * 8,
+                           _p.devices_per_rank * _p.device_bus_width) *
+                   _p.tBURST / _p.burst_length),
+      tBURST(_p.tBURST + tBURST_EXTRA),
       tRTW(_p.tRTW),
       tWTR(_p.tWTR),
       readBufferSize(_p.read_buffer_size),
@@ -146,6 +146,8 @@ class MemInterface : public AbstractMemory
      */
     GEM5_CLASS_VAR_USED const Tick tCK;
     const Tick tCS;
+    /** Data bus time of the extra bytes sent along with every burst */
+    const Tick tBURST_EXTRA;
     const Tick tBURST;
     const Tick tRTW;
     const Tick tWTR;